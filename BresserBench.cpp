@@ -0,0 +1,728 @@
+/*
+ * BresserBench.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+//Micro benchmarks of the protocol, buffer and state machine hot paths.
+//Every benchmark runs until it takes at least BENCH_MINIMUM_TIME, the results are written as json,
+//using the layout of the google benchmark library so its tools can compare the results of two releases.
+//usage: bresser_bench [json output file] [name filter]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unistd.h>
+
+#include "SerialCommand.hpp"
+#include "CircularBuffer.hpp"
+#include "SpscRingBuffer.hpp"
+#include "FrameSynchronizer.hpp"
+#include "StateMachine.hpp"
+#include "CriticalData.hpp"
+#include "SnapshotBuffer.hpp"
+#include "ExosIIMountControl.hpp"
+
+//minimum duration of a measured run in seconds.
+#define BENCH_MINIMUM_TIME (0.2)
+
+//upper limit of the iterations of a run.
+#define BENCH_MAXIMUM_ITERATIONS (1000000000ULL)
+
+//number of frames in the receive stream decoded per iteration.
+#define BENCH_STREAM_FRAMES (64)
+
+using namespace SerialDeviceControl;
+using namespace TelescopeMountControl;
+
+//keep the compiler from optimizing away a value computed by a benchmark.
+template<typename T>
+inline void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//A benchmark runs its body for the number of iterations provided, and returns the number of items processed.
+typedef std::function<uint64_t(uint64_t iterations)> BenchmarkBody;
+
+struct Benchmark
+{
+    std::string Name;
+
+    //number of threads the body runs concurrently, the iterations are per thread.
+    size_t Threads;
+
+    BenchmarkBody Body;
+};
+
+struct BenchmarkResult
+{
+    std::string Name;
+    size_t Threads;
+    uint64_t Iterations;
+
+    //wall clock and process cpu time per iteration in nanoseconds.
+    double RealTime;
+    double CpuTime;
+
+    double ItemsPerSecond;
+};
+
+static double ProcessCpuSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+//run the body with the number of threads of the benchmark, returns the number of items processed by all threads.
+static uint64_t RunThreads(const Benchmark &benchmark, uint64_t iterations)
+{
+    if(benchmark.Threads <= 1)
+    {
+        return benchmark.Body(iterations);
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<uint64_t> items(0);
+
+    for(size_t i = 0; i < benchmark.Threads; i++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            items.fetch_add(benchmark.Body(iterations));
+        }));
+    }
+
+    for(size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    return items.load();
+}
+
+//grow the iterations until the run takes long enough, the last run is the measurement.
+static BenchmarkResult RunBenchmark(const Benchmark &benchmark)
+{
+    uint64_t iterations = 1;
+
+    while(true)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double cpuStart = ProcessCpuSeconds();
+
+        uint64_t items = RunThreads(benchmark, iterations);
+
+        double cpuSeconds = ProcessCpuSeconds() - cpuStart;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(seconds >= BENCH_MINIMUM_TIME || iterations >= BENCH_MAXIMUM_ITERATIONS)
+        {
+            BenchmarkResult result;
+            result.Name = benchmark.Name;
+            result.Threads = benchmark.Threads;
+            result.Iterations = iterations;
+            result.RealTime = seconds * 1e9 / iterations;
+            result.CpuTime = cpuSeconds * 1e9 / iterations;
+            result.ItemsPerSecond = items / seconds;
+
+            return result;
+        }
+
+        //aim at 1.5 times the minimum time, growing at most tenfold per run.
+        double factor = seconds > 0 ? BENCH_MINIMUM_TIME * 1.5 / seconds : 10;
+        factor = factor > 10 ? 10 : (factor < 2 ? 2 : factor);
+        iterations = (uint64_t)(iterations * factor);
+    }
+}
+
+//Decodes the frames like SerialCommandTransceiver::OnFrameReceived does, without the callbacks.
+class DecodingFrameHandler
+{
+    public:
+        DecodingFrameHandler() :
+            mFrameCount(0),
+            mSum(0)
+        {
+
+        }
+
+        void OnFrameStarted()
+        {
+            mFrameStartReadTime = mCurrentReadTime;
+        }
+
+        void OnFrameReceived(const uint8_t* frame)
+        {
+            FloatByteConverter ra_bytes;
+            FloatByteConverter dec_bytes;
+
+            memcpy(ra_bytes.bytes, frame + 5, 4);
+            memcpy(dec_bytes.bytes, frame + 9, 4);
+
+            mSum += frame[4] + ra_bytes.decimal_number + dec_bytes.decimal_number;
+            mFrameCount++;
+        }
+
+        uint64_t mFrameCount;
+        float mSum;
+        std::chrono::steady_clock::time_point mCurrentReadTime;
+        std::chrono::steady_clock::time_point mFrameStartReadTime;
+};
+
+//State notification of the state machine benchmarks, counting the transitions.
+class CountingStateNotification : public IStateNotification<TelescopeMountState, TelescopeSignals>
+{
+    public:
+        CountingStateNotification() :
+            mTransitionCount(0)
+        {
+
+        }
+
+        virtual void OnTransitionChanged(TelescopeMountState fromState, TelescopeSignals signal, TelescopeMountState toState)
+        {
+            (void)fromState;
+            (void)signal;
+            (void)toState;
+            mTransitionCount++;
+        }
+
+        virtual void OnErrorStateReached(TelescopeMountState fromState, TelescopeSignals signal)
+        {
+            (void)fromState;
+            (void)signal;
+        }
+
+        uint64_t mTransitionCount;
+};
+
+//build a stream of position reports, the way the handbox sends them while tracking.
+static std::vector<uint8_t> PositionReportStream(size_t frameCount, size_t junkBytesPerFrame)
+{
+    std::vector<uint8_t> stream;
+
+    for(size_t i = 0; i < frameCount; i++)
+    {
+        MessageFrame frame;
+        SerialCommand::GetGotoCommandFrame(frame, (float)(i % 24), 45.0f);
+        frame[4] = SerialCommandID::TELESCOPE_POSITION_REPORT_COMMAND_ID;
+
+        stream.insert(stream.end(), frame.begin(), frame.end());
+
+        for(size_t j = 0; j < junkBytesPerFrame; j++)
+        {
+            stream.push_back((uint8_t)(0x30 + j));
+        }
+    }
+
+    return stream;
+}
+
+static uint64_t DecodeStream(const std::vector<uint8_t> &stream, uint64_t iterations)
+{
+    DecodingFrameHandler handler;
+    FrameSynchronizer<DecodingFrameHandler> synchronizer(handler);
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        synchronizer.Push(stream.data(), stream.size());
+    }
+
+    DoNotOptimize(handler.mSum);
+
+    return handler.mFrameCount;
+}
+
+//the mutex and map based state machine, as used by the mount control before the dense table.
+typedef StateMachine<TelescopeMountState, TelescopeSignals, IStateNotification<TelescopeMountState, TelescopeSignals>> MapStateMachine;
+
+//the transitions the mount control takes on every position report and goto.
+template<class MachineType>
+static void AddBenchmarkTransitions(MachineType &machine)
+{
+    machine.AddTransition(TelescopeMountState::Tracking, TelescopeSignals::Track, TelescopeMountState::Tracking);
+    machine.AddTransition(TelescopeMountState::Tracking, TelescopeSignals::Slew, TelescopeMountState::Slewing);
+    machine.AddTransition(TelescopeMountState::Slewing, TelescopeSignals::Slew, TelescopeMountState::Slewing);
+    machine.AddTransition(TelescopeMountState::Slewing, TelescopeSignals::Track, TelescopeMountState::Tracking);
+}
+
+//the tracking report of every position report.
+template<class MachineType>
+static uint64_t TransitionSelf(uint64_t iterations)
+{
+    CountingStateNotification notification;
+    MachineType machine(notification, TelescopeMountState::Tracking, TelescopeMountState::FailSafe);
+    AddBenchmarkTransitions(machine);
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        machine.DoTransition(TelescopeSignals::Track);
+    }
+
+    return notification.mTransitionCount;
+}
+
+template<class MachineType>
+static uint64_t TransitionAlternating(uint64_t iterations)
+{
+    CountingStateNotification notification;
+    MachineType machine(notification, TelescopeMountState::Tracking, TelescopeMountState::FailSafe);
+    AddBenchmarkTransitions(machine);
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        machine.DoTransition((i & 1) == 0 ? TelescopeSignals::Slew : TelescopeSignals::Track);
+    }
+
+    return notification.mTransitionCount;
+}
+
+//the state polled by the indi thread, while the dispatch thread reports the tracking state, every fourth access is a transition.
+template<class MachineType>
+static uint64_t ReadStateContended(uint64_t iterations)
+{
+    static CountingStateNotification notification;
+    static MachineType machine(notification, TelescopeMountState::Tracking, TelescopeMountState::FailSafe);
+    static bool initialized = (AddBenchmarkTransitions(machine), true);
+
+    TelescopeMountState state = TelescopeMountState::Tracking;
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        if((i & 3) == 0)
+        {
+            machine.DoTransition(TelescopeSignals::Track);
+        }
+        else
+        {
+            state = machine.CurrentState();
+        }
+    }
+
+    DoNotOptimize(state);
+    DoNotOptimize(initialized);
+
+    return iterations;
+}
+
+//get and set of the shared coordinates, by the dispatch thread and the indi thread, every fourth access is a set.
+template<CriticalDataStorage storage>
+static uint64_t CoordinatesGetSet(uint64_t iterations)
+{
+    static CriticalData<EquatorialCoordinates, storage> coordinates;
+
+    EquatorialCoordinates value = EquatorialCoordinates();
+    value.RightAscension = 1;
+    value.Declination = 2;
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        if((i & 3) == 0)
+        {
+            coordinates.Set(value);
+        }
+        else
+        {
+            value = coordinates.Get();
+        }
+    }
+
+    DoNotOptimize(value);
+
+    return iterations;
+}
+
+//the running flag polled by the threads.
+template<CriticalDataStorage storage>
+static uint64_t BoolGet(uint64_t iterations)
+{
+    static CriticalData<bool, storage> flag(false);
+
+    bool value = false;
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        value = flag.Get();
+        DoNotOptimize(value);
+    }
+
+    return iterations;
+}
+
+//Each of the three threads takes the role of a mount control thread:
+//-the dispatch thread stores the pointing coordinates of every report and checks its running flag,
+//-the indi thread polls the pointing coordinates and the motion state,
+//-the motion thread checks its running flags and the motion state, and changes the motion state now and then.
+template<CriticalDataStorage coordinatesStorage, CriticalDataStorage flagStorage, CriticalDataStorage motionStorage>
+static uint64_t MountThreads(uint64_t iterations)
+{
+    static CriticalData<EquatorialCoordinates, coordinatesStorage> coordinates;
+    static CriticalData<bool, flagStorage> readerRunning(true);
+    static CriticalData<bool, flagStorage> motionThreadRunning(true);
+    static CriticalData<bool, flagStorage> motionRunning(false);
+    static CriticalData<MotionState, motionStorage> motionState;
+    static std::atomic<size_t> nextRole(0);
+
+    size_t role = nextRole.fetch_add(1) % 3;
+
+    EquatorialCoordinates value = EquatorialCoordinates();
+    MotionState motion = MotionState();
+    bool running = false;
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        switch(role)
+        {
+            case 0:
+                value.RightAscension = (float)(i & 0xff);
+                coordinates.Set(value);
+                running = readerRunning.Get();
+                break;
+
+            case 1:
+                value = coordinates.Get();
+                motion = motionState.Get();
+                break;
+
+            default:
+                running = motionThreadRunning.Get() && !motionRunning.Get();
+                motion = motionState.Get();
+
+                if((i & 63) == 0)
+                {
+                    motion.CommandsPerSecond = (uint16_t)i;
+                    motionState.Set(motion);
+                }
+                break;
+        }
+    }
+
+    DoNotOptimize(value);
+    DoNotOptimize(motion);
+    DoNotOptimize(running);
+
+    return iterations;
+}
+
+//the mount snapshot kept behind a single mutex, for comparison with the snapshot buffer.
+class MutexMountSnapshot
+{
+    public:
+        void Publish(const MountSnapshot &snapshot)
+        {
+            mSnapshot.Set(snapshot);
+        }
+
+        MountSnapshot Read()
+        {
+            return mSnapshot.Get();
+        }
+
+    private:
+        CriticalData<MountSnapshot, MutexStorage> mSnapshot;
+};
+
+//the dispatch thread publishes a snapshot per report, the indi and motion threads read the last published one.
+template<class SnapshotContainerType>
+static uint64_t SnapshotPublishRead(uint64_t iterations)
+{
+    static SnapshotContainerType snapshots;
+    static std::atomic<size_t> nextRole(0);
+
+    bool isPublisher = (nextRole.fetch_add(1) % 3) == 0;
+
+    MountSnapshot snapshot = MountSnapshot();
+
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        if(isPublisher)
+        {
+            snapshot.Sequence = i;
+            snapshots.Publish(snapshot);
+        }
+        else
+        {
+            snapshot = snapshots.Read();
+        }
+    }
+
+    DoNotOptimize(snapshot);
+
+    return iterations;
+}
+
+static std::vector<Benchmark> Benchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back({"SerialCommand/GotoFrame", 1, [](uint64_t iterations) -> uint64_t
+    {
+        MessageFrame frame;
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            SerialCommand::GetGotoCommandFrame(frame, (float)(i & 15), 45.0f);
+            DoNotOptimize(frame);
+        }
+
+        return iterations;
+    }});
+
+    benchmarks.push_back({"SerialCommand/SetDateTimeFrame", 1, [](uint64_t iterations) -> uint64_t
+    {
+        MessageFrame frame;
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            SerialCommand::GetSetDateTimeCommandFrame(frame, 2020, 10, 17, 22, (uint8_t)(i % 60), 0, 2);
+            DoNotOptimize(frame);
+        }
+
+        return iterations;
+    }});
+
+    benchmarks.push_back({"SerialCommand/GotoMessageVector", 1, [](uint64_t iterations) -> uint64_t
+    {
+        std::vector<uint8_t> buffer;
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            buffer.clear();
+            SerialCommand::GetGotoCommandMessage(buffer, (float)(i & 15), 45.0f);
+            DoNotOptimize(buffer.data());
+        }
+
+        return iterations;
+    }});
+
+    //items are frames.
+    benchmarks.push_back({"FrameDecode/PositionReports", 1, [](uint64_t iterations) -> uint64_t
+    {
+        static const std::vector<uint8_t> stream = PositionReportStream(BENCH_STREAM_FRAMES, 0);
+        return DecodeStream(stream, iterations);
+    }});
+
+    benchmarks.push_back({"FrameDecode/PositionReportsWithJunk", 1, [](uint64_t iterations) -> uint64_t
+    {
+        static const std::vector<uint8_t> stream = PositionReportStream(BENCH_STREAM_FRAMES, 7);
+        return DecodeStream(stream, iterations);
+    }});
+
+    //the receive path of the transceiver: queue a read, then drain the queue through the synchronizer.
+    benchmarks.push_back({"FrameDecode/ReceiveQueue", 1, [](uint64_t iterations) -> uint64_t
+    {
+        static const std::vector<uint8_t> stream = PositionReportStream(BENCH_STREAM_FRAMES, 0);
+        static SpscRingBuffer<uint8_t, 4096> queue;
+
+        DecodingFrameHandler handler;
+        FrameSynchronizer<DecodingFrameHandler> synchronizer(handler);
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            queue.Write(stream.data(), stream.size());
+
+            BufferSegments<uint8_t> received = queue.ReadableSegments();
+            synchronizer.Push(received.First.Data, received.First.Length);
+            synchronizer.Push(received.Second.Data, received.Second.Length);
+            queue.Consume(received.Length());
+        }
+
+        DoNotOptimize(handler.mSum);
+
+        return handler.mFrameCount;
+    }});
+
+    benchmarks.push_back({"CircularBuffer/PushPop", 1, [](uint64_t iterations) -> uint64_t
+    {
+        CircularBuffer<uint8_t, 256> buffer;
+        uint8_t value = 0;
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            buffer.PushBack((uint8_t)i);
+            buffer.PopFront(value);
+            DoNotOptimize(value);
+        }
+
+        return iterations;
+    }});
+
+    //items are bytes.
+    benchmarks.push_back({"CircularBuffer/WriteConsumeFrame", 1, [](uint64_t iterations) -> uint64_t
+    {
+        CircularBuffer<uint8_t, 256> buffer;
+        MessageFrame frame = SerialCommand::StopMotionCommandFrame;
+        MessageFrame peeked;
+
+        for(uint64_t i = 0; i < iterations; i++)
+        {
+            buffer.Write(frame.data(), frame.size());
+            buffer.Peek(0, peeked.data(), peeked.size());
+            buffer.Consume(peeked.size());
+            DoNotOptimize(peeked);
+        }
+
+        return iterations * MESSAGE_FRAME_SIZE;
+    }});
+
+    benchmarks.push_back({"StateMachine/Map/DoTransitionSelf", 1, TransitionSelf<MapStateMachine>});
+    benchmarks.push_back({"StateMachine/Dense/DoTransitionSelf", 1, TransitionSelf<MountStateMachine>});
+    benchmarks.push_back({"StateMachine/Map/DoTransitionAlternating", 1, TransitionAlternating<MapStateMachine>});
+    benchmarks.push_back({"StateMachine/Dense/DoTransitionAlternating", 1, TransitionAlternating<MountStateMachine>});
+
+    static const size_t contentionThreads[] = {1, 2, 4};
+
+    for(size_t t = 0; t < sizeof(contentionThreads) / sizeof(contentionThreads[0]); t++)
+    {
+        std::stringstream mapStateName;
+        mapStateName << "StateMachine/Map/CurrentState/threads:" << contentionThreads[t];
+        benchmarks.push_back({mapStateName.str(), contentionThreads[t], ReadStateContended<MapStateMachine>});
+
+        std::stringstream denseStateName;
+        denseStateName << "StateMachine/Dense/CurrentState/threads:" << contentionThreads[t];
+        benchmarks.push_back({denseStateName.str(), contentionThreads[t], ReadStateContended<MountStateMachine>});
+
+        std::stringstream mutexCoordinatesName;
+        mutexCoordinatesName << "CriticalData/Mutex/CoordinatesGetSet/threads:" << contentionThreads[t];
+        benchmarks.push_back({mutexCoordinatesName.str(), contentionThreads[t], CoordinatesGetSet<MutexStorage>});
+
+        std::stringstream seqLockCoordinatesName;
+        seqLockCoordinatesName << "CriticalData/SeqLock/CoordinatesGetSet/threads:" << contentionThreads[t];
+        benchmarks.push_back({seqLockCoordinatesName.str(), contentionThreads[t], CoordinatesGetSet<SeqLockStorage>});
+
+        std::stringstream mutexFlagName;
+        mutexFlagName << "CriticalData/Mutex/BoolGet/threads:" << contentionThreads[t];
+        benchmarks.push_back({mutexFlagName.str(), contentionThreads[t], BoolGet<MutexStorage>});
+
+        std::stringstream atomicFlagName;
+        atomicFlagName << "CriticalData/Atomic/BoolGet/threads:" << contentionThreads[t];
+        benchmarks.push_back({atomicFlagName.str(), contentionThreads[t], BoolGet<AtomicStorage>});
+    }
+
+    //the indi, dispatch and motion threads accessing the shared mount values together.
+    benchmarks.push_back({"CriticalData/Mutex/MountThreads/threads:3", 3, MountThreads<MutexStorage, MutexStorage, MutexStorage>});
+    benchmarks.push_back({"CriticalData/LockFree/MountThreads/threads:3", 3, MountThreads<SeqLockStorage, AtomicStorage, AtomicStorage>});
+
+
+    //one publisher and two readers of the mount snapshot.
+    benchmarks.push_back({"MountSnapshot/Mutex/PublishRead/threads:3", 3, SnapshotPublishRead<MutexMountSnapshot>});
+    benchmarks.push_back({"MountSnapshot/SnapshotBuffer/PublishRead/threads:3", 3, SnapshotPublishRead<SnapshotBuffer<MountSnapshot, MOUNT_SNAPSHOT_SLOT_COUNT>>});
+
+    return benchmarks;
+}
+
+//write the results using the json layout of the google benchmark library.
+static void WriteJson(std::ostream &output, const std::vector<BenchmarkResult> &results)
+{
+    char hostName[256] = {0};
+    gethostname(hostName, sizeof(hostName) - 1);
+
+    time_t now = time(nullptr);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    output << "{" << std::endl;
+    output << "  \"context\": {" << std::endl;
+    output << "    \"date\": \"" << date << "\"," << std::endl;
+    output << "    \"host_name\": \"" << hostName << "\"," << std::endl;
+    output << "    \"executable\": \"bresser_bench\"," << std::endl;
+    output << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "," << std::endl;
+#ifdef NDEBUG
+    output << "    \"library_build_type\": \"release\"" << std::endl;
+#else
+    output << "    \"library_build_type\": \"debug\"" << std::endl;
+#endif
+    output << "  }," << std::endl;
+    output << "  \"benchmarks\": [" << std::endl;
+
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult &result = results[i];
+
+        output << "    {" << std::endl;
+        output << "      \"name\": \"" << result.Name << "\"," << std::endl;
+        output << "      \"run_name\": \"" << result.Name << "\"," << std::endl;
+        output << "      \"run_type\": \"iteration\"," << std::endl;
+        output << "      \"iterations\": " << result.Iterations << "," << std::endl;
+        output << "      \"threads\": " << result.Threads << "," << std::endl;
+        output << "      \"real_time\": " << result.RealTime << "," << std::endl;
+        output << "      \"cpu_time\": " << result.CpuTime << "," << std::endl;
+        output << "      \"time_unit\": \"ns\"," << std::endl;
+        output << "      \"items_per_second\": " << result.ItemsPerSecond << std::endl;
+        output << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+
+    output << "  ]" << std::endl;
+    output << "}" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string outputPath = argc > 1 ? argv[1] : "";
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    std::vector<Benchmark> benchmarks = Benchmarks();
+    std::vector<BenchmarkResult> results;
+
+    for(size_t i = 0; i < benchmarks.size(); i++)
+    {
+        if(!filter.empty() && benchmarks[i].Name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        BenchmarkResult result = RunBenchmark(benchmarks[i]);
+        results.push_back(result);
+
+        fprintf(stderr, "%-48s %12.1f ns %12.1f ns cpu %14.0f items/s\n", result.Name.c_str(), result.RealTime, result.CpuTime,
+                result.ItemsPerSecond);
+    }
+
+    if(outputPath.empty() || outputPath == "-")
+    {
+        WriteJson(std::cout, results);
+        return EXIT_SUCCESS;
+    }
+
+    std::ofstream output(outputPath.c_str());
+
+    if(!output)
+    {
+        std::cerr << "unable to write " << outputPath << "!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    WriteJson(output, results);
+
+    return EXIT_SUCCESS;
+}
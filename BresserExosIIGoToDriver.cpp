@@ -23,11 +23,9 @@
 
 #include "BresserExosIIGoToDriver.hpp"
 
-#define COMMANDS_PER_SECOND (10)
-
-#define GUIDE_PULSE_TIMEOUT (6)
+#include <cstring>
 
-#define GUIDE_TIMEOUT (20)
+#define COMMANDS_PER_SECOND (10)
 
 //if the mount is not in a specific state after that time its, considered fault.
 #define DRIVER_WATCHDOG_TIMEOUT (10000)
@@ -41,7 +39,10 @@ static std::unique_ptr<BresserExosIIDriver> mount(new BresserExosIIDriver());
 //sets the scope abilities, and default settings.
 BresserExosIIDriver::BresserExosIIDriver() : GI(this),
     mInterfaceWrapper(),
-    mMountControl(mInterfaceWrapper)
+    mMountControl(mInterfaceWrapper),
+    mGuideEngine(mMountControl),
+    mGuideCompletionCallbackID(0),
+    mLastPublishedSequence(0)
 {
     setVersion(BresserExosIIGoToDriverForIndi_VERSION_MAJOR, BresserExosIIGoToDriverForIndi_VERSION_MINOR);
 
@@ -50,12 +51,6 @@ BresserExosIIDriver::BresserExosIIDriver() : GI(this),
     SetTelescopeCapability(TELESCOPE_CAN_PARK | TELESCOPE_CAN_GOTO | TELESCOPE_CAN_SYNC | TELESCOPE_CAN_ABORT |
                            TELESCOPE_HAS_TIME | TELESCOPE_HAS_LOCATION, 0);
 
-    mGuideStateNS.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-    mGuideStateNS.remaining_messages = 0;
-
-    mGuideStateEW.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-    mGuideStateEW.remaining_messages = 0;
-
     setDefaultPollingPeriod(500);
 }
 
@@ -83,6 +78,78 @@ bool BresserExosIIDriver::initProperties()
 
     defineProperty(&SourceCodeRepositoryURLTP);
 
+    IUFillNumber(&LinkStatisticsN[LINK_BYTES_RECEIVED], "BYTES_RECEIVED", "Bytes received", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_BYTES_SENT], "BYTES_SENT", "Bytes sent", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_FRAMES_RECEIVED], "FRAMES_RECEIVED", "Frames received", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_POSITION_REPORTS], "POSITION_REPORTS", "Position reports", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_SITE_LOCATION_REPORTS], "SITE_LOCATION_REPORTS", "Site location reports", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_JUNK_BYTES], "JUNK_BYTES", "Junk bytes skipped", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_OVERFLOW_BYTES], "OVERFLOW_BYTES", "Bytes lost by overflow", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_NAN_PAYLOADS], "NAN_PAYLOADS", "NaN payloads", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_WRITE_FAILURES], "WRITE_FAILURES", "Write failures", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_REJECTED_FRAMES], "REJECTED_FRAMES", "Frames rejected (not queued)", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_FRAME_INTERVAL_MIN], "FRAME_INTERVAL_MIN", "Frame interval min (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_FRAME_INTERVAL_MEAN], "FRAME_INTERVAL_MEAN", "Frame interval mean (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_FRAME_INTERVAL_MAX], "FRAME_INTERVAL_MAX", "Frame interval max (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&LinkStatisticsN[LINK_FRAME_INTERVAL_JITTER], "FRAME_INTERVAL_JITTER", "Frame interval jitter (ms)", "%.1f", 0, 1e9, 0, 0);
+
+    IUFillNumberVector(&LinkStatisticsNP, LinkStatisticsN, LINK_STATISTICS_COUNT, getDeviceName(), "LINK_STATISTICS", "Serial Link",
+                       DIAGNOSTICS_TAB, IP_RO, 0, IPS_IDLE);
+
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_NS_RATE], "NS_RATE", "N/S rate (arcsec/frame)", "%.3f", -1e6, 1e6, 0, 0);
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_NS_LAG], "NS_LAG", "N/S lag (ms)", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_NS_SAMPLES], "NS_SAMPLES", "N/S pulses measured", "%.0f", 0, 1e18, 0, 0);
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_WE_RATE], "WE_RATE", "W/E rate (arcsec/frame)", "%.3f", -1e6, 1e6, 0, 0);
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_WE_LAG], "WE_LAG", "W/E lag (ms)", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&GuideCalibrationN[CALIBRATION_WE_SAMPLES], "WE_SAMPLES", "W/E pulses measured", "%.0f", 0, 1e18, 0, 0);
+
+    IUFillNumberVector(&GuideCalibrationNP, GuideCalibrationN, CALIBRATION_COUNT, getDeviceName(), "GUIDE_CALIBRATION", "Guide Calibration",
+                       MOTION_TAB, IP_RO, 0, IPS_IDLE);
+
+    IUFillNumber(&PointingEstimateN[ESTIMATE_REPORTED_RA], "REPORTED_RA", "Reported RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_REPORTED_DEC], "REPORTED_DEC", "Reported DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_RA], "ESTIMATED_RA", "Estimated RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_DEC], "ESTIMATED_DEC", "Estimated DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_RA_UNCERTAINTY], "RA_UNCERTAINTY", "RA uncertainty (arcsec)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_DEC_UNCERTAINTY], "DEC_UNCERTAINTY", "DEC uncertainty (arcsec)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_RA_RATE], "RA_RATE", "RA rate (arcsec/s)", "%.1f", -1e9, 1e9, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_DEC_RATE], "DEC_RATE", "DEC rate (arcsec/s)", "%.1f", -1e9, 1e9, 0, 0);
+    IUFillNumber(&PointingEstimateN[ESTIMATE_REPORT_AGE], "REPORT_AGE", "Report age (ms)", "%.0f", -1e9, 1e9, 0, 0);
+
+    IUFillNumberVector(&PointingEstimateNP, PointingEstimateN, ESTIMATE_COUNT, getDeviceName(), "POINTING_ESTIMATE", "Pointing Estimate",
+                       DIAGNOSTICS_TAB, IP_RO, 0, IPS_IDLE);
+
+    IUFillSwitch(&GuidePulseSizingS[0], "DURATION", "Duration", ISS_ON);
+    IUFillSwitch(&GuidePulseSizingS[1], "MEASURED_RATE", "Measured Rate", ISS_OFF);
+
+    IUFillSwitchVector(&GuidePulseSizingSP, GuidePulseSizingS, 2, getDeviceName(), "GUIDE_PULSE_SIZING", "Pulse Sizing",
+                       MOTION_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    IUFillNumber(&GuideTargetRateN[0], "RATE", "Rate (x sidereal)", "%.2f", 0.05, 2.0, 0.05, 0.5);
+
+    IUFillNumberVector(&GuideTargetRateNP, GuideTargetRateN, 1, getDeviceName(), "GUIDE_TARGET_RATE", "Sized Guide Rate",
+                       MOTION_TAB, IP_RW, 0, IPS_IDLE);
+
+    IUFillSwitch(&LatencyDumpS[0], "DUMP", "Log", ISS_OFF);
+
+    IUFillSwitchVector(&LatencyDumpSP, LatencyDumpS, 1, getDeviceName(), "LATENCY_DUMP", "Latency Histograms",
+                       DIAGNOSTICS_TAB, IP_RW, ISR_ATMOST1, 0, IPS_IDLE);
+
+    //capturing is available while disconnected, so the handshake can be captured as well.
+    IUFillText(&CaptureFileT[0], "PATH", "Path", DEFAULT_CAPTURE_FILE);
+
+    IUFillTextVector(&CaptureFileTP, CaptureFileT, 1, getDeviceName(), "CAPTURE_FILE", "Capture File",
+                     DIAGNOSTICS_TAB, IP_RW, 0, IPS_IDLE);
+
+    IUFillSwitch(&CaptureS[0], "START", "Start", ISS_OFF);
+    IUFillSwitch(&CaptureS[1], "STOP", "Stop", ISS_ON);
+
+    IUFillSwitchVector(&CaptureSP, CaptureS, 2, getDeviceName(), "CAPTURE", "Serial Capture",
+                       DIAGNOSTICS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    defineProperty(&CaptureFileTP);
+    defineProperty(&CaptureSP);
+
     SetParkDataType(PARK_NONE);
 
     TrackState = SCOPE_IDLE;
@@ -100,6 +167,25 @@ bool BresserExosIIDriver::updateProperties()
     bool rc = INDI::Telescope::updateProperties();
     GI::updateProperties();
 
+    if(isConnected())
+    {
+        defineProperty(&LinkStatisticsNP);
+        defineProperty(&LatencyDumpSP);
+        defineProperty(&GuideCalibrationNP);
+        defineProperty(&GuidePulseSizingSP);
+        defineProperty(&GuideTargetRateNP);
+        defineProperty(&PointingEstimateNP);
+    }
+    else
+    {
+        deleteProperty(LinkStatisticsNP.name);
+        deleteProperty(LatencyDumpSP.name);
+        deleteProperty(GuideCalibrationNP.name);
+        deleteProperty(GuidePulseSizingSP.name);
+        deleteProperty(GuideTargetRateNP.name);
+        deleteProperty(PointingEstimateNP.name);
+    }
+
     return rc;
 }
 
@@ -127,8 +213,22 @@ bool BresserExosIIDriver::Handshake()
 
     mInterfaceWrapper.SetFD(PortFD);
 
+    mStoredToPublishedLatency.Reset();
+    mEndToEndLatency.Reset();
+    mMountControl.GetDecodeToStoredLatency().Reset();
+    mMountControl.GetMotionCadenceJitter().Reset();
+    mGuideCalibrator.Reset();
+    mPointingEstimator.Reset();
+
     mMountControl.Start();
 
+    mGuideEngine.Start();
+
+    if(mGuideCompletionCallbackID == 0)
+    {
+        mGuideCompletionCallbackID = IEAddCallback(mGuideEngine.GetCompletionFD(), guideCompletionHelper, this);
+    }
+
     bool rc = INDI::Telescope::Handshake();
 
     return rc;
@@ -137,6 +237,14 @@ bool BresserExosIIDriver::Handshake()
 //Disconnect from the mount, and disable serial transmission.
 bool BresserExosIIDriver::Disconnect()
 {
+    mGuideEngine.Stop();
+
+    if(mGuideCompletionCallbackID != 0)
+    {
+        IERmCallback(mGuideCompletionCallbackID);
+        mGuideCompletionCallbackID = 0;
+    }
+
     mMountControl.Stop();
 
     LOG_INFO("BresserExosIIDriver::Disconnect: disabling pointing reporting, disconnected from scope. Bye!");
@@ -155,10 +263,46 @@ const char* BresserExosIIDriver::getDefaultName()
 //Periodically polled function to update the state of the driver, and synchronize it with the mount.
 bool BresserExosIIDriver::ReadScopeStatus()
 {
-    SerialDeviceControl::EquatorialCoordinates currentCoordinates = mMountControl.GetPointingCoordinates();
-    NewRaDec(currentCoordinates.RightAscension, currentCoordinates.Declination);
+    //coordinates and state are taken from the same snapshot, so they always belong together.
+    TelescopeMountControl::MountSnapshot snapshot = mMountControl.GetMountSnapshot();
+
+    //each position reported is correlated with the guide pulses, and added to the pointing estimate once.
+    if(snapshot.RawCoordinates.TimeStamp != mLastPositionReportTime)
+    {
+        mLastPositionReportTime = snapshot.RawCoordinates.TimeStamp;
+
+        mPointingEstimator.AddReport(snapshot.Coordinates);
+
+        if(mGuideCalibrator.AddPosition(snapshot.RawCoordinates))
+        {
+            UpdateGuideCalibration();
+        }
+    }
 
-    TelescopeMountControl::TelescopeMountState currentState = mMountControl.GetTelescopeState();
+    TelescopeMountControl::TelescopeMountState currentState = snapshot.State;
+
+    //the position is only extrapolated while the mount moves, a stopped mount is reported as is,
+    //since the end of a slew only shows in the next report.
+    TelescopeMountControl::PointingEstimate estimate = mPointingEstimator.Predict(std::chrono::steady_clock::now());
+
+    bool isMoving = currentState == TelescopeMountControl::TelescopeMountState::Slewing ||
+                    currentState == TelescopeMountControl::TelescopeMountState::ParkingIssued ||
+                    currentState == TelescopeMountControl::TelescopeMountState::MoveWhileTracking;
+
+    bool isEstimatePublished = isMoving && estimate.IsValid;
+
+    if(isEstimatePublished)
+    {
+        NewRaDec(estimate.Coordinates.RightAscension, estimate.Coordinates.Declination);
+    }
+    else
+    {
+        NewRaDec(snapshot.Coordinates.RightAscension, snapshot.Coordinates.Declination);
+    }
+
+    RecordPublishLatency();
+
+    UpdatePointingEstimate(snapshot, estimate, isEstimatePublished);
 
     //Translate the mount state to driver state.
     switch(currentState)
@@ -200,11 +344,118 @@ bool BresserExosIIDriver::ReadScopeStatus()
             break;
     }
 
+    UpdateLinkStatistics();
+
     return true;
 }
 
+//record the latencies of the pointing coordinates published, each pointing report is only counted once.
+void BresserExosIIDriver::RecordPublishLatency()
+{
+    TelescopeMountControl::PointingTiming timing = mMountControl.GetPointingTiming();
+
+    if(timing.Sequence == 0 || timing.Sequence == mLastPublishedSequence)
+    {
+        return;
+    }
+
+    mLastPublishedSequence = timing.Sequence;
+
+    std::chrono::steady_clock::time_point publishTime = std::chrono::steady_clock::now();
+
+    mStoredToPublishedLatency.Record(publishTime - timing.StoredTime);
+    mEndToEndLatency.Record(publishTime - timing.ReadTime);
+}
+
+//log all latency histograms of the receive path.
+void BresserExosIIDriver::DumpLatencyHistograms()
+{
+    LOGF_INFO("%s", mMountControl.GetReadToDecodeLatency().ToString("read -> decoded").c_str());
+    LOGF_INFO("%s", mMountControl.GetDecodeToStoredLatency().ToString("decoded -> stored").c_str());
+    LOGF_INFO("%s", mStoredToPublishedLatency.ToString("stored -> published").c_str());
+    LOGF_INFO("%s", mEndToEndLatency.ToString("read -> published").c_str());
+    LOGF_INFO("%s", mMountControl.GetMotionCadenceJitter().ToString("motion command lateness").c_str());
+    LOGF_INFO("motion commands skipped: %llu", (unsigned long long)mMountControl.GetSkippedMotionCommandCount());
+}
+
+//publish the current serial link metrics.
+void BresserExosIIDriver::UpdateLinkStatistics()
+{
+    SerialDeviceControl::SerialLinkStatistics statistics;
+    mMountControl.GetLinkStatistics(statistics);
+
+    LinkStatisticsN[LINK_BYTES_RECEIVED].value = statistics.BytesReceived;
+    LinkStatisticsN[LINK_BYTES_SENT].value = statistics.BytesSent;
+    LinkStatisticsN[LINK_FRAMES_RECEIVED].value = statistics.FramesReceived;
+    LinkStatisticsN[LINK_POSITION_REPORTS].value = statistics.PositionReportsReceived;
+    LinkStatisticsN[LINK_SITE_LOCATION_REPORTS].value = statistics.SiteLocationReportsReceived;
+    LinkStatisticsN[LINK_JUNK_BYTES].value = statistics.JunkBytes;
+    LinkStatisticsN[LINK_OVERFLOW_BYTES].value = statistics.OverflowBytes;
+    LinkStatisticsN[LINK_NAN_PAYLOADS].value = statistics.NaNPayloads;
+    LinkStatisticsN[LINK_WRITE_FAILURES].value = statistics.WriteFailures;
+    LinkStatisticsN[LINK_REJECTED_FRAMES].value = statistics.RejectedFrames;
+    LinkStatisticsN[LINK_FRAME_INTERVAL_MIN].value = statistics.MinimumFrameInterval;
+    LinkStatisticsN[LINK_FRAME_INTERVAL_MEAN].value = statistics.MeanFrameInterval;
+    LinkStatisticsN[LINK_FRAME_INTERVAL_MAX].value = statistics.MaximumFrameInterval;
+    LinkStatisticsN[LINK_FRAME_INTERVAL_JITTER].value = statistics.FrameIntervalJitter;
+
+    //errors on the link are flagged, so a degrading adapter is visible before the session drops.
+    bool linkErrors = (statistics.OverflowBytes > 0 || statistics.WriteFailures > 0 || statistics.RejectedFrames > 0);
+    LinkStatisticsNP.s = linkErrors ? IPS_ALERT : IPS_OK;
+
+    IDSetNumber(&LinkStatisticsNP, nullptr);
+}
+
+//publish the guide rates and lags measured.
+void BresserExosIIDriver::UpdateGuideCalibration()
+{
+    TelescopeMountControl::GuideAxisCalibration declination = mGuideCalibrator.GetCalibration(TelescopeMountControl::GuideAxis::DeclinationAxis);
+    TelescopeMountControl::GuideAxisCalibration rightAscension = mGuideCalibrator.GetCalibration(TelescopeMountControl::GuideAxis::RightAscensionAxis);
+
+    GuideCalibrationN[CALIBRATION_NS_RATE].value = declination.ArcsecondsPerFrame;
+    GuideCalibrationN[CALIBRATION_NS_LAG].value = declination.LagMilliseconds;
+    GuideCalibrationN[CALIBRATION_NS_SAMPLES].value = declination.SampleCount;
+    GuideCalibrationN[CALIBRATION_WE_RATE].value = rightAscension.ArcsecondsPerFrame;
+    GuideCalibrationN[CALIBRATION_WE_LAG].value = rightAscension.LagMilliseconds;
+    GuideCalibrationN[CALIBRATION_WE_SAMPLES].value = rightAscension.SampleCount;
+
+    bool isCalibrated = mGuideCalibrator.IsCalibrated(TelescopeMountControl::GuideAxis::DeclinationAxis) &&
+                        mGuideCalibrator.IsCalibrated(TelescopeMountControl::GuideAxis::RightAscensionAxis);
+    GuideCalibrationNP.s = isCalibrated ? IPS_OK : IPS_BUSY;
+
+    IDSetNumber(&GuideCalibrationNP, nullptr);
+}
+
+//publish the reported position next to the estimate, so the estimate can be checked against the raw reports.
+void BresserExosIIDriver::UpdatePointingEstimate(const TelescopeMountControl::MountSnapshot &snapshot,
+        const TelescopeMountControl::PointingEstimate &estimate, bool isEstimatePublished)
+{
+    PointingEstimateN[ESTIMATE_REPORTED_RA].value = snapshot.Coordinates.RightAscension;
+    PointingEstimateN[ESTIMATE_REPORTED_DEC].value = snapshot.Coordinates.Declination;
+    PointingEstimateN[ESTIMATE_RA].value = estimate.Coordinates.RightAscension;
+    PointingEstimateN[ESTIMATE_DEC].value = estimate.Coordinates.Declination;
+    PointingEstimateN[ESTIMATE_RA_UNCERTAINTY].value = estimate.RightAscensionUncertainty;
+    PointingEstimateN[ESTIMATE_DEC_UNCERTAINTY].value = estimate.DeclinationUncertainty;
+    PointingEstimateN[ESTIMATE_RA_RATE].value = estimate.RightAscensionRate;
+    PointingEstimateN[ESTIMATE_DEC_RATE].value = estimate.DeclinationRate;
+    PointingEstimateN[ESTIMATE_REPORT_AGE].value = estimate.AgeMilliseconds;
+
+    PointingEstimateNP.s = isEstimatePublished ? IPS_OK : IPS_IDLE;
+
+    IDSetNumber(&PointingEstimateNP, nullptr);
+}
+
 bool BresserExosIIDriver::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
+    if(dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, GuideTargetRateNP.name) == 0)
+    {
+        IUUpdateNumber(&GuideTargetRateNP, values, names, n);
+        GuideTargetRateNP.s = IPS_OK;
+        IDSetNumber(&GuideTargetRateNP, nullptr);
+
+        return true;
+    }
+
     // Check guider interface
     if (GI::processNumber(dev, name, values, names, n))
         return true;
@@ -212,8 +463,73 @@ bool BresserExosIIDriver::ISNewNumber(const char *dev, const char *name, double
     return INDI::Telescope::ISNewNumber(dev, name, values, names, n);
 }
 
+bool BresserExosIIDriver::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if(dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, LatencyDumpSP.name) == 0)
+    {
+        DumpLatencyHistograms();
+
+        IUResetSwitch(&LatencyDumpSP);
+        LatencyDumpSP.s = IPS_OK;
+        IDSetSwitch(&LatencyDumpSP, nullptr);
+
+        return true;
+    }
+
+    if(dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, GuidePulseSizingSP.name) == 0)
+    {
+        IUUpdateSwitch(&GuidePulseSizingSP, states, names, n);
+        GuidePulseSizingSP.s = IPS_OK;
+        IDSetSwitch(&GuidePulseSizingSP, nullptr);
+
+        return true;
+    }
+
+    if(dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, CaptureSP.name) == 0)
+    {
+        IUUpdateSwitch(&CaptureSP, states, names, n);
+
+        if(IUFindOnSwitchIndex(&CaptureSP) == 0)
+        {
+            if(mMountControl.StartCapture(CaptureFileT[0].text))
+            {
+                LOGF_INFO("capturing the serial traffic to %s.", CaptureFileT[0].text);
+                CaptureSP.s = IPS_BUSY;
+            }
+            else
+            {
+                LOGF_ERROR("unable to open the capture file %s!", CaptureFileT[0].text);
+                IUResetSwitch(&CaptureSP);
+                CaptureS[1].s = ISS_ON;
+                CaptureSP.s = IPS_ALERT;
+            }
+        }
+        else
+        {
+            mMountControl.StopCapture();
+            CaptureSP.s = IPS_IDLE;
+        }
+
+        IDSetSwitch(&CaptureSP, nullptr);
+
+        return true;
+    }
+
+    return INDI::Telescope::ISNewSwitch(dev, name, states, names, n);
+}
+
 bool BresserExosIIDriver::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
+    if(dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, CaptureFileTP.name) == 0)
+    {
+        //the path is used by the next start of the capture.
+        IUUpdateText(&CaptureFileTP, texts, names, n);
+        CaptureFileTP.s = IPS_OK;
+        IDSetText(&CaptureFileTP, nullptr);
+
+        return true;
+    }
+
     return INDI::Telescope::ISNewText(dev, name, texts, names, n);
 }
 
@@ -261,20 +577,8 @@ bool BresserExosIIDriver::Abort()
 {
     LOG_INFO("BresserExosIIDriver::Abort: motion stopped!");
 
-    if (GuideNSTID)
-    {
-        IERmTimer(GuideNSTID);
-        GuideNSTID = 0;
-    }
-
-    if (GuideWETID)
-    {
-        IERmTimer(GuideWETID);
-        GuideNSTID = 0;
-    }
-
-    GuideNSNP.apply();
-    GuideWENP.apply();
+    //the aborted pulses are reported by the completion callback.
+    mGuideEngine.Abort();
 
     return mMountControl.StopMotion();
 }
@@ -440,147 +744,49 @@ bool BresserExosIIDriver::MoveWE(INDI_DIR_WE dir, TelescopeMotionCommand command
 //double these amounts if full duplex is possible.
 IPState BresserExosIIDriver::GuideNorth(uint32_t ms)
 {
-    //LOGF_INFO("BresserExosIIDriver::GuideNorth: guiding %d ms", ms);
-
-    if(mMountControl.GetTelescopeState() == TelescopeMountControl::TelescopeMountState::MoveWhileTracking)
-    {
-        LOG_INFO("BresserExosIIDriver::GuideNorth: motion while tracking stopped!");
-        mMountControl.StopMotionToDirection();
-    }
-
-    uint32_t messages = ms / GUIDE_TIMEOUT;
-
-    LOGF_INFO("BresserExosIIDriver::GuideNord: guiding %d ms (%d messages)", ms, messages);
-
-    if (GuideNSTID) //reset timer if any.
-    {
-        IERmTimer(GuideNSTID);
-        GuideNSTID = 0;
-    }
-
-    if(messages > 0)
-    {
-        mMountControl.GuideNorth(); // send one pulse
-        messages--;
-
-        mGuideStateNS.remaining_messages = messages;
-        mGuideStateNS.direction = SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID;
-
-        GuideNSTID = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperN, this); //wait for nex pulse if any.
-
-        return IPS_BUSY;
-    }
-
-    return IPS_IDLE;
+    return StartGuidePulse(SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID, ms);
 }
 
 IPState BresserExosIIDriver::GuideSouth(uint32_t ms)
 {
-    //LOGF_INFO("BresserExosIIDriver::GuideSouth: guiding %d ms", ms);
-
-    if(mMountControl.GetTelescopeState() == TelescopeMountControl::TelescopeMountState::MoveWhileTracking)
-    {
-        LOG_INFO("BresserExosIIDriver::GuideNorth: motion while tracking stopped!");
-        mMountControl.StopMotionToDirection();
-    }
-
-    uint32_t messages = ms / GUIDE_TIMEOUT;
-
-    LOGF_INFO("BresserExosIIDriver::GuideSouth: guiding %d ms (%d messages)", ms, messages);
-
-    if (GuideNSTID) //reset timer if any.
-    {
-        IERmTimer(GuideNSTID);
-        GuideNSTID = 0;
-    }
-
-    if(messages > 0)
-    {
-        mMountControl.GuideSouth(); // send one pulse
-        messages--;
-
-        mGuideStateNS.remaining_messages = messages;
-        mGuideStateNS.direction = SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID;
-
-        GuideNSTID = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperS, this); //wait for nex pulse if any.
-
-        return IPS_BUSY;
-    }
-
-    return IPS_IDLE;
+    return StartGuidePulse(SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID, ms);
 }
 
 IPState BresserExosIIDriver::GuideEast(uint32_t ms)
 {
-    //LOGF_INFO("BresserExosIIDriver::GuideEast: guiding %d ms", ms);
-
-    if(mMountControl.GetTelescopeState() == TelescopeMountControl::TelescopeMountState::MoveWhileTracking)
-    {
-        LOG_INFO("BresserExosIIDriver::GuideNorth: motion while tracking stopped!");
-        mMountControl.StopMotionToDirection();
-    }
-
-    uint32_t messages = ms / GUIDE_TIMEOUT;
-
-    LOGF_INFO("BresserExosIIDriver::GuideEast: guiding %d ms (%d messages)", ms, messages);
-
-    if (GuideWETID) //reset timer if any.
-    {
-        IERmTimer(GuideWETID);
-        GuideWETID = 0;
-    }
-
-    if(messages > 0)
-    {
-        mMountControl.GuideEast(); // send one pulse
-
-        messages--;
-
-        mGuideStateEW.direction = SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID;
-        mGuideStateEW.remaining_messages = messages;
-
-        GuideWETID = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperE, this); //wait for nex pulse if any.
-
-        return IPS_BUSY;
-    }
-
-    return IPS_IDLE;
+    return StartGuidePulse(SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID, ms);
 }
 
 IPState BresserExosIIDriver::GuideWest(uint32_t ms)
 {
-    //LOGF_INFO("BresserExosIIDriver::GuideWest: guiding %d ms", ms);
+    return StartGuidePulse(SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID, ms);
+}
 
+//The pulse is sent by the guide engine as one move frame per GUIDE_FRAME_PERIOD, the north/south and east/west pulses run at the same time.
+//Its completion is reported by the completion callback.
+IPState BresserExosIIDriver::StartGuidePulse(SerialDeviceControl::SerialCommandID direction, uint32_t ms)
+{
     if(mMountControl.GetTelescopeState() == TelescopeMountControl::TelescopeMountState::MoveWhileTracking)
     {
-        LOG_INFO("BresserExosIIDriver::GuideNorth: motion while tracking stopped!");
+        LOG_INFO("BresserExosIIDriver::StartGuidePulse: motion while tracking stopped!");
         mMountControl.StopMotionToDirection();
     }
 
-    uint32_t messages = ms / GUIDE_TIMEOUT;
-
-    LOGF_INFO("BresserExosIIDriver::GuideWest: guiding %d ms (%d messages)", ms, messages);
-
-    if (GuideWETID) //reset timer if any.
-    {
-        IERmTimer(GuideWETID);
-        GuideWETID = 0;
-    }
-
-    if(messages > 0)
+    //the pulse is sized so the axis moves as far as it would at the sized guide rate, once enough pulses of the axis were measured.
+    if(IUFindOnSwitchIndex(&GuidePulseSizingSP) == 1)
     {
-        mMountControl.GuideWest();
+        bool isDeclination = direction == SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID ||
+                             direction == SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID;
 
-        messages--;
-        mGuideStateEW.remaining_messages = messages;
-        mGuideStateEW.direction = SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID;
+        ms = mGuideCalibrator.SizePulse(isDeclination ? TelescopeMountControl::GuideAxis::DeclinationAxis :
+                                        TelescopeMountControl::GuideAxis::RightAscensionAxis, ms, GuideTargetRateN[0].value);
+    }
 
-        GuideWETID = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperW, this); //wait for nex pulse if any.
+    uint32_t messages = mGuideEngine.Pulse(direction, ms);
 
-        return IPS_BUSY;
-    }
+    LOGF_INFO("BresserExosIIDriver::StartGuidePulse: guiding direction %d, %d ms (%d messages)", direction, ms, messages);
 
-    return IPS_IDLE;
+    return messages > 0 ? IPS_BUSY : IPS_IDLE;
 }
 
 void BresserExosIIDriver::DriverWatchDog(void *p)
@@ -603,122 +809,55 @@ void BresserExosIIDriver::DriverWatchDog(void *p)
     driverInstance->LogInfo("INFO: Communication seems to be established!");
 }
 
-void BresserExosIIDriver::guideTimeout(SerialDeviceControl::SerialCommandID direction)
+//report the pulses completed by the guide engine, the guide properties show the guide motion actually done.
+void BresserExosIIDriver::guideCompleted()
 {
-    bool continuePulsing = false;
-    switch(direction)
+    TelescopeMountControl::GuidePulseCompletion completion;
+
+    while(mGuideEngine.PopCompletion(completion))
     {
-        case SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID:
-            continuePulsing = mGuideStateNS.remaining_messages > 0;
+        double sendSpan = std::chrono::duration<double, std::milli>(completion.LastFrameTime - completion.FirstFrameTime).count();
 
-            if(continuePulsing)
-            {
-                mGuideStateNS.remaining_messages--;
-                mMountControl.GuideNorth();
-                GuideNSNP.setState(IPS_BUSY);
-                GuideNSTID  = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperN, this);
-            }
-            else
-            {
-                GuideNSNP.setState(IPS_IDLE);
-                GuideNSTID = 0;
-                mGuideStateNS.remaining_messages = 0;
-                mGuideStateNS.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-                GuideNSNP.apply();
-            }
-            break;
+        LOGF_INFO("BresserExosIIDriver::guideCompleted: direction %d requested %d ms, executed %d ms, %d frames sent, %d dropped, queued within %.1f ms%s",
+                  completion.Direction, completion.RequestedMilliseconds, completion.ExecutedMilliseconds, completion.FramesSent,
+                  completion.FramesDropped, completion.FramesSent > 0 ? sendSpan : 0.0, completion.Aborted ? " (aborted)" : "");
 
-        case SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID:
-            continuePulsing = mGuideStateNS.remaining_messages > 0;
+        //the pulse is measured once the positions following it are reported.
+        mGuideCalibrator.AddPulse(completion);
 
-            if(continuePulsing)
-            {
-                mGuideStateNS.remaining_messages--;
-                mMountControl.GuideSouth();
-                GuideNSNP.setState(IPS_BUSY);
-                GuideNSTID  = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperS, this);
-            }
-            else
-            {
-                GuideNSNP.setState(IPS_IDLE);
-                GuideNSTID = 0;
-                mGuideStateNS.remaining_messages = 0;
-                mGuideStateNS.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-                GuideNSNP.apply();
-            }
-            break;
+        //the first element of the properties is north and west respectively.
+        switch(completion.Direction)
+        {
+            case SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID:
+                GuideNSNP[0].setValue(completion.ExecutedMilliseconds);
+                break;
 
-        case SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID:
-            continuePulsing = mGuideStateEW.remaining_messages > 0;
+            case SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID:
+                GuideNSNP[1].setValue(completion.ExecutedMilliseconds);
+                break;
 
-            if(continuePulsing)
-            {
-                mGuideStateEW.remaining_messages--;
-                mMountControl.GuideWest();
-                GuideWENP.setState(IPS_BUSY);
-                GuideNSTID  = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperW, this);
-            }
-            else
-            {
-                GuideWENP.setState(IPS_IDLE);
-                GuideWETID = 0;
-                mGuideStateEW.remaining_messages = 0;
-                mGuideStateEW.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-                GuideWENP.apply();
-            }
-            break;
+            case SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID:
+                GuideWENP[0].setValue(completion.ExecutedMilliseconds);
+                break;
 
-        case SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID:
-            continuePulsing = mGuideStateEW.remaining_messages > 0;
+            case SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID:
+                GuideWENP[1].setValue(completion.ExecutedMilliseconds);
+                break;
 
-            if(continuePulsing)
-            {
-                mGuideStateEW.remaining_messages--;
-                mMountControl.GuideEast();
-                GuideWENP.setState(IPS_BUSY);
-                GuideNSTID  = IEAddTimer(GUIDE_TIMEOUT, guideTimeoutHelperE, this);
-            }
-            else
-            {
-                GuideWENP.setState(IPS_IDLE);
-                GuideWETID = 0;
-                mGuideStateEW.remaining_messages = 0;
-                mGuideStateEW.direction = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-                GuideWENP.apply();
-            }
-            break;
-
-        default:
-            GuideWENP.setState(IPS_IDLE);
-            GuideWETID = 0;
-            GuideWENP.apply();
+            default:
+                break;
+        }
 
-            GuideNSNP.setState(IPS_IDLE);
-            GuideNSTID = 0;
-            GuideNSNP.apply();
-            break;
+        GuideComplete(completion.Axis == TelescopeMountControl::GuideAxis::DeclinationAxis ? AXIS_DE : AXIS_RA);
     }
 }
 
-//GUIDE The timer helper functions.
-void BresserExosIIDriver::guideTimeoutHelperN(void *p)
+//GUIDE The completion callback function.
+void BresserExosIIDriver::guideCompletionHelper(int fd, void *p)
 {
-    static_cast<BresserExosIIDriver*>(p)->guideTimeout(SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID);
-}
+    INDI_UNUSED(fd);
 
-void BresserExosIIDriver::guideTimeoutHelperS(void *p)
-{
-    static_cast<BresserExosIIDriver*>(p)->guideTimeout(SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID);
-}
-
-void BresserExosIIDriver::guideTimeoutHelperW(void *p)
-{
-    static_cast<BresserExosIIDriver*>(p)->guideTimeout(SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID);
-}
-
-void BresserExosIIDriver::guideTimeoutHelperE(void *p)
-{
-    static_cast<BresserExosIIDriver*>(p)->guideTimeout(SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID);
+    static_cast<BresserExosIIDriver*>(p)->guideCompleted();
 }
 
 void BresserExosIIDriver::LogError(const char* message)
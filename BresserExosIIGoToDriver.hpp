@@ -36,17 +36,67 @@
 
 #include "IndiSerialWrapper.hpp"
 #include "ExosIIMountControl.hpp"
+#include "PulseGuideEngine.hpp"
+#include "GuideRateCalibrator.hpp"
+#include "PointingEstimator.hpp"
 #include "SerialCommand.hpp"
+#include "LatencyHistogram.hpp"
 
 #include "config.h"
 
+//tab showing the serial link metrics.
+#define DIAGNOSTICS_TAB "Diagnostics"
+
+//file the serial traffic is appended to, unless configured otherwise.
+#define DEFAULT_CAPTURE_FILE "/tmp/indi_bresserexos2_capture.bin"
+
 namespace GoToDriver
 {
-        
-        struct GuideState
+        //indices of the serial link metrics property.
+        enum LinkStatisticsIndex
+        {
+                LINK_BYTES_RECEIVED = 0,
+                LINK_BYTES_SENT,
+                LINK_FRAMES_RECEIVED,
+                LINK_POSITION_REPORTS,
+                LINK_SITE_LOCATION_REPORTS,
+                LINK_JUNK_BYTES,
+                LINK_OVERFLOW_BYTES,
+                LINK_NAN_PAYLOADS,
+                LINK_WRITE_FAILURES,
+                LINK_REJECTED_FRAMES,
+                LINK_FRAME_INTERVAL_MIN,
+                LINK_FRAME_INTERVAL_MEAN,
+                LINK_FRAME_INTERVAL_MAX,
+                LINK_FRAME_INTERVAL_JITTER,
+                LINK_STATISTICS_COUNT
+        };
+
+        //indices of the guide calibration property.
+        enum GuideCalibrationIndex
+        {
+                CALIBRATION_NS_RATE = 0,
+                CALIBRATION_NS_LAG,
+                CALIBRATION_NS_SAMPLES,
+                CALIBRATION_WE_RATE,
+                CALIBRATION_WE_LAG,
+                CALIBRATION_WE_SAMPLES,
+                CALIBRATION_COUNT
+        };
+
+        //indices of the pointing estimate property.
+        enum PointingEstimateIndex
         {
-                SerialDeviceControl::SerialCommandID direction;
-                uint32_t remaining_messages;
+                ESTIMATE_REPORTED_RA = 0,
+                ESTIMATE_REPORTED_DEC,
+                ESTIMATE_RA,
+                ESTIMATE_DEC,
+                ESTIMATE_RA_UNCERTAINTY,
+                ESTIMATE_DEC_UNCERTAINTY,
+                ESTIMATE_RA_RATE,
+                ESTIMATE_DEC_RATE,
+                ESTIMATE_REPORT_AGE,
+                ESTIMATE_COUNT
         };
 
 //Main wrapper class for the indi driver interface.
@@ -85,6 +135,9 @@ class BresserExosIIDriver : public INDI::Telescope, public INDI::GuiderInterface
         //update properties from the application -> number
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
 
+        //update properties from the application -> switch
+        virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+
         //update properties from the application -> text
         virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
 
@@ -124,11 +177,8 @@ class BresserExosIIDriver : public INDI::Telescope, public INDI::GuiderInterface
         virtual IPState GuideEast(uint32_t ms) override;
         virtual IPState GuideWest(uint32_t ms) override;
 
-        // Pulse Guide timeout callbacks.
-        static void guideTimeoutHelperN(void *p);
-        static void guideTimeoutHelperS(void *p);
-        static void guideTimeoutHelperE(void *p);
-        static void guideTimeoutHelperW(void *p);
+        // Pulse Guide completion callback, called by the indi event loop when the guide engine completed pulses.
+        static void guideCompletionHelper(int fd, void *p);
 
     private:
         IndiSerialWrapper mInterfaceWrapper;
@@ -137,12 +187,51 @@ class BresserExosIIDriver : public INDI::Telescope, public INDI::GuiderInterface
 
         unsigned int DBG_SCOPE;
 
-        int GuideNSTID;
-        int GuideWETID;
+        //executes the guide pulses on its own thread.
+        TelescopeMountControl::PulseGuideEngine<TelescopeMountControl::ExosIIMountControl<IndiSerialWrapper>> mGuideEngine;
+
+        //id of the event loop callback watching the guide completions, 0 if not registered.
+        int mGuideCompletionCallbackID;
 
         static void DriverWatchDog(void *p);
 
-        void guideTimeout(SerialDeviceControl::SerialCommandID direction);
+        //stop manual motion and hand the pulse to the guide engine.
+        IPState StartGuidePulse(SerialDeviceControl::SerialCommandID direction, uint32_t ms);
+
+        //report the pulses completed by the guide engine to the guider interface.
+        void guideCompleted();
+
+        //measures the guide rates from the pulses and the positions reported.
+        TelescopeMountControl::GuideRateCalibrator mGuideCalibrator;
+
+        //read time of the last position handed to the calibrator and the pointing estimator.
+        std::chrono::steady_clock::time_point mLastPositionReportTime;
+
+        //measured guide rate and lag of both axes, read only.
+        INumber GuideCalibrationN[CALIBRATION_COUNT];
+        INumberVectorProperty GuideCalibrationNP;
+
+        //size the pulses by their duration, or by the measured rate.
+        ISwitch GuidePulseSizingS[2];
+        ISwitchVectorProperty GuidePulseSizingSP;
+
+        //guide rate the pulses are sized for, as a multiple of the sidereal rate.
+        INumber GuideTargetRateN[1];
+        INumberVectorProperty GuideTargetRateNP;
+
+        //publish the measurements of the calibrator.
+        void UpdateGuideCalibration();
+
+        //predicts the position between the position reports.
+        TelescopeMountControl::PointingEstimator mPointingEstimator;
+
+        //reported and estimated position, with the uncertainty and rates of the estimate, read only.
+        INumber PointingEstimateN[ESTIMATE_COUNT];
+        INumberVectorProperty PointingEstimateNP;
+
+        //publish the reported position and its estimate, the property is ok while the estimate is published as the scope position.
+        void UpdatePointingEstimate(const TelescopeMountControl::MountSnapshot &snapshot, const TelescopeMountControl::PointingEstimate &estimate,
+                                    bool isEstimatePublished);
 
         void LogError(const char* mesage);
 
@@ -151,9 +240,39 @@ class BresserExosIIDriver : public INDI::Telescope, public INDI::GuiderInterface
         IText SourceCodeRepositoryURLT[1] = {};
         ITextVectorProperty SourceCodeRepositoryURLTP;
 
-        GuideState mGuideStateNS;
-        
-        GuideState mGuideStateEW;
+        //health metrics of the serial link, read only.
+        INumber LinkStatisticsN[LINK_STATISTICS_COUNT];
+        INumberVectorProperty LinkStatisticsNP;
+
+        //publish the current serial link metrics.
+        void UpdateLinkStatistics();
+
+        //log the latency histograms of the receive path on request.
+        ISwitch LatencyDumpS[1];
+        ISwitchVectorProperty LatencyDumpSP;
+
+        //path of the capture file.
+        IText CaptureFileT[1] = {};
+        ITextVectorProperty CaptureFileTP;
+
+        //start or stop capturing the serial traffic.
+        ISwitch CaptureS[2];
+        ISwitchVectorProperty CaptureSP;
+
+        //latencies from storing the pointing coordinates to publishing them.
+        SerialDeviceControl::LatencyHistogram mStoredToPublishedLatency;
+
+        //latencies from reading the pointing report to publishing its coordinates.
+        SerialDeviceControl::LatencyHistogram mEndToEndLatency;
+
+        //sequence number of the pointing report published last.
+        uint64_t mLastPublishedSequence;
+
+        //record the latencies of the pointing coordinates published, if they were not published before.
+        void RecordPublishLatency();
+
+        //log all latency histograms of the receive path.
+        void DumpLatencyHistograms();
 };
 }
 
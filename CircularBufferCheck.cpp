@@ -0,0 +1,476 @@
+/*
+ * CircularBufferCheck.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+//Exhaustive check of the CircularBuffer against a std::deque model.
+//For every capacity, every start position of the ring and every fill level, each operation is applied with every
+//count and offset in range (and one beyond), and the contents are compared with the model afterwards.
+//Runs of random operations cover sequences of operations on top.
+//usage: bresser_buffer_check, returns EXIT_FAILURE on the first mismatch.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <random>
+
+#include "CircularBuffer.hpp"
+
+//number of random operations applied per capacity.
+#define CHECK_RANDOM_OPERATIONS (200000)
+
+using SerialDeviceControl::CircularBuffer;
+using SerialDeviceControl::BufferSegments;
+
+typedef std::deque<uint32_t> Model;
+
+//counts the cases checked, and describes the case in progress for the failure report.
+struct CheckContext
+{
+    uint64_t Cases;
+    std::string Case;
+};
+
+static bool Fail(CheckContext &context, const std::string &message)
+{
+    std::cerr << "CircularBufferCheck: " << context.Case << ": " << message << std::endl;
+    return false;
+}
+
+//compare the buffer with the model, using the size, At and the readable segments.
+template<size_t capacity>
+static bool Compare(CheckContext &context, CircularBuffer<uint32_t, capacity> &buffer, const Model &model)
+{
+    context.Cases++;
+
+    if(buffer.Size() != model.size() || buffer.Free() != capacity - model.size() ||
+            buffer.IsEmpty() != model.empty() || buffer.IsFull() != (model.size() == capacity))
+    {
+        std::ostringstream message;
+        message << "size " << buffer.Size() << " expected " << model.size();
+        return Fail(context, message.str());
+    }
+
+    for(size_t i = 0; i < model.size(); i++)
+    {
+        if(buffer.At(i) != model[i])
+        {
+            std::ostringstream message;
+            message << "At(" << i << ") " << buffer.At(i) << " expected " << model[i];
+            return Fail(context, message.str());
+        }
+    }
+
+    BufferSegments<uint32_t> segments = buffer.ReadableSegments();
+
+    if(segments.Length() != model.size())
+    {
+        return Fail(context, "readable segments do not cover the contents");
+    }
+
+    for(size_t i = 0; i < segments.Length(); i++)
+    {
+        uint32_t value = i < segments.First.Length ? segments.First.Data[i] : segments.Second.Data[i - segments.First.Length];
+
+        if(value != model[i])
+        {
+            return Fail(context, "readable segments differ from the contents");
+        }
+    }
+
+    return true;
+}
+
+//bring the buffer and the model into the state provided: the ring starts at the position and holds length values.
+template<size_t capacity>
+static void Prepare(CircularBuffer<uint32_t, capacity> &buffer, Model &model, size_t start, size_t length, uint32_t &nextValue)
+{
+    buffer = CircularBuffer<uint32_t, capacity>();
+    model.clear();
+
+    uint32_t dropped;
+
+    for(size_t i = 0; i < start; i++)
+    {
+        buffer.PushBack(0);
+        buffer.PopFront(dropped);
+    }
+
+    for(size_t i = 0; i < length; i++)
+    {
+        buffer.PushBack(nextValue);
+        model.push_back(nextValue);
+        nextValue++;
+    }
+}
+
+//apply every operation with every count and offset to the state provided.
+template<size_t capacity>
+static bool CheckState(CheckContext &context, size_t start, size_t length)
+{
+    CircularBuffer<uint32_t, capacity> buffer;
+    Model model;
+    uint32_t nextValue = 1;
+
+    std::ostringstream prefix;
+    prefix << "capacity " << capacity << " start " << start << " length " << length;
+
+    //PushBack
+    Prepare(buffer, model, start, length, nextValue);
+    context.Case = prefix.str() + " PushBack";
+
+    bool pushed = buffer.PushBack(nextValue);
+
+    if(pushed != (length < capacity))
+    {
+        return Fail(context, "PushBack result");
+    }
+
+    if(pushed)
+    {
+        model.push_back(nextValue);
+    }
+
+    nextValue++;
+
+    if(!Compare(context, buffer, model))
+    {
+        return false;
+    }
+
+    //PopFront and Front
+    Prepare(buffer, model, start, length, nextValue);
+    context.Case = prefix.str() + " PopFront";
+
+    uint32_t front = 0;
+    uint32_t popped = 0;
+
+    if(buffer.Front(front) != !model.empty() || buffer.PopFront(popped) != !model.empty())
+    {
+        return Fail(context, "PopFront/Front result");
+    }
+
+    if(!model.empty())
+    {
+        if(front != model.front() || popped != model.front())
+        {
+            return Fail(context, "PopFront/Front value");
+        }
+
+        model.pop_front();
+    }
+
+    if(!Compare(context, buffer, model))
+    {
+        return false;
+    }
+
+    //Clear
+    Prepare(buffer, model, start, length, nextValue);
+    context.Case = prefix.str() + " Clear";
+
+    buffer.Clear();
+    model.clear();
+
+    if(!Compare(context, buffer, model))
+    {
+        return false;
+    }
+
+    for(size_t count = 0; count <= capacity + 1; count++)
+    {
+        std::ostringstream countCase;
+        countCase << prefix.str() << " count " << count;
+
+        //Write
+        Prepare(buffer, model, start, length, nextValue);
+        context.Case = countCase.str() + " Write";
+
+        std::vector<uint32_t> values(count);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            values[i] = nextValue++;
+        }
+
+        size_t written = buffer.Write(values.data(), count);
+        size_t expectedWritten = std::min(count, capacity - length);
+
+        if(written != expectedWritten)
+        {
+            return Fail(context, "Write result");
+        }
+
+        model.insert(model.end(), values.begin(), values.begin() + expectedWritten);
+
+        if(!Compare(context, buffer, model))
+        {
+            return false;
+        }
+
+        //Consume
+        Prepare(buffer, model, start, length, nextValue);
+        context.Case = countCase.str() + " Consume";
+
+        size_t consumed = buffer.Consume(count);
+        size_t expectedConsumed = std::min(count, length);
+
+        if(consumed != expectedConsumed)
+        {
+            return Fail(context, "Consume result");
+        }
+
+        model.erase(model.begin(), model.begin() + expectedConsumed);
+
+        if(!Compare(context, buffer, model))
+        {
+            return false;
+        }
+
+        //WritableSegments and Commit, the segments are filled completely but only count values are committed.
+        Prepare(buffer, model, start, length, nextValue);
+        context.Case = countCase.str() + " Commit";
+
+        BufferSegments<uint32_t> writable = buffer.WritableSegments();
+
+        if(writable.Length() != capacity - length)
+        {
+            return Fail(context, "writable segments do not cover the free storage");
+        }
+
+        std::vector<uint32_t> filled;
+
+        for(size_t i = 0; i < writable.Length(); i++)
+        {
+            uint32_t &slot = i < writable.First.Length ? writable.First.Data[i] : writable.Second.Data[i - writable.First.Length];
+            slot = nextValue++;
+            filled.push_back(slot);
+        }
+
+        size_t committed = buffer.Commit(count);
+
+        if(committed != std::min(count, capacity - length))
+        {
+            return Fail(context, "Commit result");
+        }
+
+        model.insert(model.end(), filled.begin(), filled.begin() + committed);
+
+        if(!Compare(context, buffer, model))
+        {
+            return false;
+        }
+
+        for(size_t offset = 0; offset <= length + 1; offset++)
+        {
+            std::ostringstream offsetCase;
+            offsetCase << countCase.str() << " offset " << offset;
+
+            //Peek
+            Prepare(buffer, model, start, length, nextValue);
+            context.Case = offsetCase.str() + " Peek";
+
+            std::vector<uint32_t> peeked(count + 1, 0);
+            size_t copied = buffer.Peek(offset, peeked.data(), count);
+            size_t available = offset < length ? length - offset : 0;
+
+            if(copied != std::min(count, available))
+            {
+                return Fail(context, "Peek result");
+            }
+
+            for(size_t i = 0; i < copied; i++)
+            {
+                if(peeked[i] != model[offset + i])
+                {
+                    return Fail(context, "Peek value");
+                }
+            }
+
+            //nothing is copied beyond the values returned.
+            if(peeked[copied] != 0)
+            {
+                return Fail(context, "Peek copied too many values");
+            }
+
+            if(!Compare(context, buffer, model))
+            {
+                return false;
+            }
+        }
+    }
+
+    //ReadableSegments at every offset.
+    for(size_t offset = 0; offset <= length + 1; offset++)
+    {
+        std::ostringstream offsetCase;
+        offsetCase << prefix.str() << " offset " << offset << " ReadableSegments";
+
+        Prepare(buffer, model, start, length, nextValue);
+        context.Case = offsetCase.str();
+        context.Cases++;
+
+        BufferSegments<uint32_t> readable = buffer.ReadableSegments(offset);
+        size_t skipped = std::min(offset, length);
+
+        if(readable.Length() != length - skipped)
+        {
+            return Fail(context, "readable segments length");
+        }
+
+        //a view wraps around at most once, the second segment starts at the storage begin.
+        if(readable.Second.Length > 0 && readable.First.Length == 0)
+        {
+            return Fail(context, "second segment used while the first one is empty");
+        }
+
+        for(size_t i = 0; i < readable.Length(); i++)
+        {
+            uint32_t value = i < readable.First.Length ? readable.First.Data[i] : readable.Second.Data[i - readable.First.Length];
+
+            if(value != model[skipped + i])
+            {
+                return Fail(context, "readable segments value");
+            }
+        }
+    }
+
+    return true;
+}
+
+//apply random operations, keeping the model in step.
+template<size_t capacity>
+static bool CheckRandom(CheckContext &context)
+{
+    CircularBuffer<uint32_t, capacity> buffer;
+    Model model;
+    uint32_t nextValue = 1;
+    std::mt19937 generator(capacity);
+
+    std::ostringstream prefix;
+    prefix << "capacity " << capacity << " random";
+    context.Case = prefix.str();
+
+    for(size_t operation = 0; operation < CHECK_RANDOM_OPERATIONS; operation++)
+    {
+        size_t count = generator() % (capacity + 2);
+
+        switch(generator() % 4)
+        {
+            case 0:
+            {
+                std::vector<uint32_t> values(count);
+
+                for(size_t i = 0; i < count; i++)
+                {
+                    values[i] = nextValue++;
+                }
+
+                size_t written = buffer.Write(values.data(), count);
+                model.insert(model.end(), values.begin(), values.begin() + written);
+            }
+            break;
+
+            case 1:
+            {
+                size_t consumed = buffer.Consume(count);
+
+                if(consumed != std::min(count, model.size()))
+                {
+                    return Fail(context, "Consume result");
+                }
+
+                model.erase(model.begin(), model.begin() + consumed);
+            }
+            break;
+
+            case 2:
+                if(buffer.PushBack(nextValue))
+                {
+                    model.push_back(nextValue);
+                }
+
+                nextValue++;
+                break;
+
+            default:
+            {
+                uint32_t popped = 0;
+
+                if(buffer.PopFront(popped))
+                {
+                    if(model.empty() || popped != model.front())
+                    {
+                        return Fail(context, "PopFront value");
+                    }
+
+                    model.pop_front();
+                }
+            }
+            break;
+        }
+
+        if(!Compare(context, buffer, model))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<size_t capacity>
+static bool CheckCapacity(CheckContext &context)
+{
+    for(size_t start = 0; start < capacity; start++)
+    {
+        for(size_t length = 0; length <= capacity; length++)
+        {
+            if(!CheckState<capacity>(context, start, length))
+            {
+                return false;
+            }
+        }
+    }
+
+    return CheckRandom<capacity>(context);
+}
+
+int main()
+{
+    CheckContext context;
+    context.Cases = 0;
+
+    bool rc = CheckCapacity<1>(context) &&
+              CheckCapacity<2>(context) &&
+              CheckCapacity<4>(context) &&
+              CheckCapacity<8>(context) &&
+              CheckCapacity<16>(context) &&
+              CheckCapacity<32>(context);
+
+    std::cout << "CircularBufferCheck: " << context.Cases << " cases checked, " << (rc ? "passed" : "failed") << std::endl;
+
+    return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,679 @@
+/*
+ * EndToEndHarness.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+//End to end harness running the real driver binary under indiserver against the simulated handbox.
+//The handbox is attached to the master side of a pseudo terminal, the driver opens the slave device like a serial adapter.
+//A minimal INDI client scripts the connect, goto, abort, pulse guide and park sequences and measures:
+//-latency from sending a command to the corresponding property update,
+//-cpu time of the driver process per second,
+//-update rate of the pointing coordinates.
+//usage: bresserexos2_e2e [driver executable] [indiserver port]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <pty.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <termios.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "SimulatedHandbox.hpp"
+#include "EventNotifier.hpp"
+
+//device name announced by the driver.
+#define E2E_DEVICE_NAME "BRESSER Messier EXOS-2 EQ GoTo"
+
+//defaults of the command line arguments.
+#define E2E_DEFAULT_DRIVER "indi_bresserexos2"
+#define E2E_DEFAULT_PORT (7625)
+
+//timeouts in milliseconds.
+#define E2E_SERVER_START_TIMEOUT (5000)
+#define E2E_COMMAND_TIMEOUT (15000)
+#define E2E_SLEW_TIMEOUT (120000)
+
+//duration of the idle observation window in seconds.
+#define E2E_IDLE_WINDOW (10)
+
+//size of the bridge and client receive buffers.
+#define E2E_BUFFER_SIZE (4096)
+
+using SerialDeviceControl::SimulatedHandbox;
+using SerialDeviceControl::EventNotifier;
+
+//A property update received from the server.
+struct IndiElement
+{
+    //xml tag, e.g. setNumberVector.
+    std::string Tag;
+
+    //property name and state attributes.
+    std::string Name;
+    std::string State;
+
+    //values of the property members by member name.
+    std::map<std::string, std::string> Values;
+
+    //time the update arrived.
+    std::chrono::steady_clock::time_point Received;
+};
+
+//Copies the data between the pty master and the simulated handbox.
+class PtyHandboxBridge
+{
+    public:
+        PtyHandboxBridge(SimulatedHandbox &handbox, int masterFD) :
+            mHandbox(handbox),
+            mMasterFD(masterFD)
+        {
+
+        }
+
+        void Start()
+        {
+            mHandbox.Open();
+            mThread = std::thread(&PtyHandboxBridge::BridgeThreadFunction, this);
+        }
+
+        void Stop()
+        {
+            mStopEvent.Signal();
+            mThread.join();
+            mHandbox.Close();
+        }
+
+    private:
+        SimulatedHandbox &mHandbox;
+        int mMasterFD;
+        EventNotifier mStopEvent;
+        std::thread mThread;
+        uint8_t mBuffer[E2E_BUFFER_SIZE];
+
+        void BridgeThreadFunction()
+        {
+            while(true)
+            {
+                struct pollfd descriptors[3];
+
+                descriptors[0].fd = mMasterFD;
+                descriptors[0].events = POLLIN;
+                descriptors[0].revents = 0;
+
+                descriptors[1].fd = mHandbox.GetFD();
+                descriptors[1].events = POLLIN;
+                descriptors[1].revents = 0;
+
+                descriptors[2].fd = mStopEvent.GetFD();
+                descriptors[2].events = POLLIN;
+                descriptors[2].revents = 0;
+
+                if(poll(descriptors, 3, -1) < 0 && errno != EINTR)
+                {
+                    break;
+                }
+
+                if(descriptors[2].revents != 0)
+                {
+                    break;
+                }
+
+                //driver -> handbox, the slave side may be closed while the driver is not connected.
+                if((descriptors[0].revents & POLLIN) != 0)
+                {
+                    ssize_t count = read(mMasterFD, mBuffer, sizeof(mBuffer));
+
+                    if(count > 0)
+                    {
+                        mHandbox.Write(mBuffer, 0, count);
+                    }
+                }
+                else if((descriptors[0].revents & (POLLHUP | POLLERR)) != 0)
+                {
+                    mStopEvent.Wait(10);
+                }
+
+                //handbox -> driver.
+                if((descriptors[1].revents & POLLIN) != 0)
+                {
+                    size_t count = mHandbox.Read(mBuffer, sizeof(mBuffer));
+
+                    if(count > 0 && write(mMasterFD, mBuffer, count) < 0)
+                    {
+                        std::cerr << "bridge: write to pty failed!" << std::endl;
+                    }
+                }
+            }
+        }
+};
+
+//Minimal INDI client, parsing the top level elements of the xml stream.
+class IndiClient
+{
+    public:
+        IndiClient() :
+            mSocket(-1)
+        {
+
+        }
+
+        ~IndiClient()
+        {
+            if(mSocket > -1)
+            {
+                close(mSocket);
+            }
+        }
+
+        //connect to the server, retrying until it accepts connections or the timeout elapsed.
+        bool Connect(int port, long timeoutMilliseconds)
+        {
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+
+            while(std::chrono::steady_clock::now() < deadline)
+            {
+                mSocket = socket(AF_INET, SOCK_STREAM, 0);
+
+                struct sockaddr_in address;
+                memset(&address, 0, sizeof(address));
+                address.sin_family = AF_INET;
+                address.sin_port = htons(port);
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                if(connect(mSocket, (struct sockaddr*)&address, sizeof(address)) == 0)
+                {
+                    return Send("<getProperties version=\"1.7\"/>\n");
+                }
+
+                close(mSocket);
+                mSocket = -1;
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+
+            return false;
+        }
+
+        bool Send(const std::string &xml)
+        {
+            return send(mSocket, xml.c_str(), xml.size(), 0) == (ssize_t)xml.size();
+        }
+
+        bool SendNewText(const std::string &property, const std::string &member, const std::string &value)
+        {
+            return Send("<newTextVector device=\"" E2E_DEVICE_NAME "\" name=\"" + property + "\"><oneText name=\"" + member + "\">" + value +
+                        "</oneText></newTextVector>\n");
+        }
+
+        bool SendNewSwitch(const std::string &property, const std::string &member)
+        {
+            return Send("<newSwitchVector device=\"" E2E_DEVICE_NAME "\" name=\"" + property + "\"><oneSwitch name=\"" + member +
+                        "\">On</oneSwitch></newSwitchVector>\n");
+        }
+
+        bool SendNewNumbers(const std::string &property, const std::string &first, double firstValue, const std::string &second, double secondValue)
+        {
+            std::stringstream xml;
+            xml << "<newNumberVector device=\"" E2E_DEVICE_NAME "\" name=\"" << property << "\">"
+                << "<oneNumber name=\"" << first << "\">" << firstValue << "</oneNumber>";
+
+            if(!second.empty())
+            {
+                xml << "<oneNumber name=\"" << second << "\">" << secondValue << "</oneNumber>";
+            }
+
+            xml << "</newNumberVector>\n";
+
+            return Send(xml.str());
+        }
+
+        //wait for an update of the property, optionally with the state provided. Returns false on timeout.
+        bool WaitFor(const std::string &property, const std::string &state, long timeoutMilliseconds, IndiElement &element)
+        {
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+
+            while(Next(element, deadline))
+            {
+                if(element.Name == property && (state.empty() || element.State == state))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //count the updates of the property within the duration provided.
+        size_t CountUpdates(const std::string &property, long durationMilliseconds)
+        {
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(durationMilliseconds);
+            IndiElement element;
+            size_t count = 0;
+
+            while(Next(element, deadline))
+            {
+                if(element.Tag == "setNumberVector" && element.Name == property)
+                {
+                    count++;
+                }
+            }
+
+            return count;
+        }
+
+    private:
+        int mSocket;
+        std::string mStream;
+
+        //returns the next element of the stream, false if the deadline passed.
+        bool Next(IndiElement &element, std::chrono::steady_clock::time_point deadline)
+        {
+            while(true)
+            {
+                if(Parse(element))
+                {
+                    return true;
+                }
+
+                long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+                if(remaining <= 0)
+                {
+                    return false;
+                }
+
+                struct pollfd descriptor;
+                descriptor.fd = mSocket;
+                descriptor.events = POLLIN;
+                descriptor.revents = 0;
+
+                if(poll(&descriptor, 1, remaining) <= 0)
+                {
+                    continue;
+                }
+
+                char buffer[E2E_BUFFER_SIZE];
+                ssize_t count = recv(mSocket, buffer, sizeof(buffer), 0);
+
+                if(count <= 0)
+                {
+                    return false;
+                }
+
+                mStream.append(buffer, count);
+            }
+        }
+
+        //extract the first complete top level element from the stream.
+        bool Parse(IndiElement &element)
+        {
+            size_t start = mStream.find('<');
+
+            if(start == std::string::npos)
+            {
+                mStream.clear();
+                return false;
+            }
+
+            size_t tagEnd = mStream.find_first_of(" \t\r\n/>", start + 1);
+            size_t startTagEnd = mStream.find('>', start);
+
+            if(tagEnd == std::string::npos || startTagEnd == std::string::npos)
+            {
+                return false;
+            }
+
+            std::string tag = mStream.substr(start + 1, tagEnd - start - 1);
+            std::string startTag = mStream.substr(start, startTagEnd - start + 1);
+            size_t end;
+
+            if(tag[0] == '?' || startTag[startTag.size() - 2] == '/')
+            {
+                end = startTagEnd + 1;
+            }
+            else
+            {
+                size_t closing = mStream.find("</" + tag + ">", startTagEnd);
+
+                if(closing == std::string::npos)
+                {
+                    return false;
+                }
+
+                end = closing + tag.size() + 3;
+            }
+
+            std::string content = mStream.substr(startTagEnd + 1, end - startTagEnd - 1);
+            mStream.erase(0, end);
+
+            element.Tag = tag;
+            element.Name = Attribute(startTag, "name");
+            element.State = Attribute(startTag, "state");
+            element.Values.clear();
+            element.Received = std::chrono::steady_clock::now();
+
+            //members are <oneNumber name="RA">value</oneNumber> and alike.
+            size_t member = content.find("<one");
+
+            while(member != std::string::npos)
+            {
+                size_t memberTagEnd = content.find('>', member);
+                size_t memberEnd = content.find("</", memberTagEnd);
+
+                if(memberTagEnd == std::string::npos || memberEnd == std::string::npos)
+                {
+                    break;
+                }
+
+                std::string value = content.substr(memberTagEnd + 1, memberEnd - memberTagEnd - 1);
+                size_t first = value.find_first_not_of(" \t\r\n");
+                size_t last = value.find_last_not_of(" \t\r\n");
+
+                element.Values[Attribute(content.substr(member, memberTagEnd - member), "name")] =
+                    first == std::string::npos ? "" : value.substr(first, last - first + 1);
+
+                member = content.find("<one", memberEnd);
+            }
+
+            return true;
+        }
+
+        static std::string Attribute(const std::string &startTag, const std::string &name)
+        {
+            std::string key = " " + name + "=\"";
+            size_t position = startTag.find(key);
+
+            if(position == std::string::npos)
+            {
+                return "";
+            }
+
+            position += key.size();
+
+            return startTag.substr(position, startTag.find('"', position) - position);
+        }
+};
+
+//returns the pid of the first child process of the parent provided, -1 if there is none.
+static pid_t FindChildProcess(pid_t parent)
+{
+    DIR* directory = opendir("/proc");
+    pid_t child = -1;
+
+    if(directory == nullptr)
+    {
+        return -1;
+    }
+
+    struct dirent* entry;
+
+    while(child < 0 && (entry = readdir(directory)) != nullptr)
+    {
+        pid_t pid = atoi(entry->d_name);
+
+        if(pid <= 0)
+        {
+            continue;
+        }
+
+        std::ifstream stat(std::string("/proc/") + entry->d_name + "/stat");
+        std::string line;
+        std::getline(stat, line);
+
+        //the fields following the command name in parentheses are: state ppid ...
+        size_t commandEnd = line.rfind(')');
+
+        if(commandEnd == std::string::npos)
+        {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(commandEnd + 1));
+        std::string state;
+        pid_t ppid = 0;
+        fields >> state >> ppid;
+
+        if(ppid == parent)
+        {
+            child = pid;
+        }
+    }
+
+    closedir(directory);
+
+    return child;
+}
+
+//returns the user and system cpu time of the process in seconds, negative if unavailable.
+static double ProcessCpuTime(pid_t pid)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+
+    size_t commandEnd = line.rfind(')');
+
+    if(commandEnd == std::string::npos)
+    {
+        return -1;
+    }
+
+    //utime and stime are the 12th and 13th field after the command name.
+    std::istringstream fields(line.substr(commandEnd + 1));
+    std::string skipped;
+
+    for(size_t i = 0; i < 11; i++)
+    {
+        fields >> skipped;
+    }
+
+    unsigned long userTicks = 0;
+    unsigned long systemTicks = 0;
+    fields >> userTicks >> systemTicks;
+
+    return (double)(userTicks + systemTicks) / sysconf(_SC_CLK_TCK);
+}
+
+static long Milliseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+//send a command and wait for the expected property update, reporting the latency.
+template<class SendFunction>
+static bool Step(IndiClient &client, const char* name, SendFunction sendCommand, const std::string &property, const std::string &state,
+                 long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+    IndiElement element;
+
+    if(!sendCommand() || !client.WaitFor(property, state, timeoutMilliseconds, element))
+    {
+        std::cout << name << ": timeout waiting for " << property << " " << state << std::endl;
+        return false;
+    }
+
+    std::cout << name << ": " << Milliseconds(sent, element.Received) << " ms" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string driver = argc > 1 ? argv[1] : E2E_DEFAULT_DRIVER;
+    int port = argc > 2 ? atoi(argv[2]) : E2E_DEFAULT_PORT;
+
+    int masterFD = -1;
+    int slaveFD = -1;
+    char slaveName[256];
+
+    if(openpty(&masterFD, &slaveFD, slaveName, nullptr, nullptr) != 0)
+    {
+        std::cerr << "openpty failed!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //raw slave, so the frames are passed unchanged even before the driver configures the port.
+    struct termios settings;
+    tcgetattr(slaveFD, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slaveFD, TCSANOW, &settings);
+
+    SimulatedHandbox handbox;
+    PtyHandboxBridge bridge(handbox, masterFD);
+    bridge.Start();
+
+    pid_t server = fork();
+
+    if(server == 0)
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+
+        std::string portArgument = std::to_string(port);
+        execlp("indiserver", "indiserver", "-p", portArgument.c_str(), driver.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+
+    IndiClient client;
+    bool rc = client.Connect(port, E2E_SERVER_START_TIMEOUT);
+
+    if(!rc)
+    {
+        std::cout << "unable to connect to indiserver on port " << port << std::endl;
+    }
+
+    pid_t driverProcess = -1;
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+
+    if(rc)
+    {
+        IndiElement element;
+        rc = client.WaitFor("DEVICE_PORT", "", E2E_COMMAND_TIMEOUT, element) && client.SendNewText("DEVICE_PORT", "PORT", slaveName);
+
+        driverProcess = FindChildProcess(server);
+    }
+
+    rc = rc && Step(client, "connect", [&]()
+    {
+        return client.SendNewSwitch("CONNECTION", "CONNECT");
+    }, "CONNECTION", "Ok", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "first coordinates", [&]()
+    {
+        return true;
+    }, "EQUATORIAL_EOD_COORD", "", E2E_COMMAND_TIMEOUT);
+
+    double idleCpuStart = ProcessCpuTime(driverProcess);
+    size_t idleUpdates = rc ? client.CountUpdates("EQUATORIAL_EOD_COORD", E2E_IDLE_WINDOW * 1000) : 0;
+    double idleCpu = ProcessCpuTime(driverProcess) - idleCpuStart;
+
+    rc = rc && Step(client, "goto -> slewing", [&]()
+    {
+        return client.SendNewNumbers("EQUATORIAL_EOD_COORD", "RA", 5.5, "DEC", 20.0);
+    }, "EQUATORIAL_EOD_COORD", "Busy", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "abort", [&]()
+    {
+        return client.SendNewSwitch("TELESCOPE_ABORT_MOTION", "ABORT");
+    }, "TELESCOPE_ABORT_MOTION", "", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "abort -> idle", [&]()
+    {
+        return true;
+    }, "EQUATORIAL_EOD_COORD", "Idle", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "goto -> tracking", [&]()
+    {
+        return client.SendNewNumbers("EQUATORIAL_EOD_COORD", "RA", 5.5, "DEC", 20.0);
+    }, "EQUATORIAL_EOD_COORD", "Ok", E2E_SLEW_TIMEOUT);
+
+    rc = rc && Step(client, "pulse guide north 200 ms", [&]()
+    {
+        return client.SendNewNumbers("TELESCOPE_TIMED_GUIDE_NS", "TIMED_GUIDE_N", 200, "TIMED_GUIDE_S", 0);
+    }, "TELESCOPE_TIMED_GUIDE_NS", "Ok", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "pulse guide east 200 ms", [&]()
+    {
+        return client.SendNewNumbers("TELESCOPE_TIMED_GUIDE_WE", "TIMED_GUIDE_E", 200, "TIMED_GUIDE_W", 0);
+    }, "TELESCOPE_TIMED_GUIDE_WE", "Ok", E2E_COMMAND_TIMEOUT);
+
+    rc = rc && Step(client, "park", [&]()
+    {
+        return client.SendNewSwitch("TELESCOPE_PARK", "PARK");
+    }, "TELESCOPE_PARK", "Ok", E2E_SLEW_TIMEOUT);
+
+    rc = rc && Step(client, "disconnect", [&]()
+    {
+        return client.SendNewSwitch("CONNECTION", "DISCONNECT");
+    }, "CONNECTION", "", E2E_COMMAND_TIMEOUT);
+
+    double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    double runCpu = ProcessCpuTime(driverProcess);
+
+    if(driverProcess > 0)
+    {
+        std::cout << "driver cpu (idle window): " << (idleCpu * 1000.0 / E2E_IDLE_WINDOW) << " ms/s" << std::endl;
+        std::cout << "driver cpu (whole run): " << (runCpu * 1000.0 / runSeconds) << " ms/s" << std::endl;
+    }
+    else
+    {
+        std::cout << "driver process not found, no cpu statistics." << std::endl;
+    }
+
+    std::cout << "coordinate updates (idle window): " << ((double)idleUpdates / E2E_IDLE_WINDOW) << " /s" << std::endl;
+    std::cout << "handbox commands: " << handbox.GetValidCommandCount() << " invalid: " << handbox.GetInvalidCommandCount()
+              << " reports: " << handbox.GetReportCount() << " dropped: " << handbox.GetDroppedReportCount() << std::endl;
+
+    if(server > 0)
+    {
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+    }
+
+    bridge.Stop();
+
+    close(slaveFD);
+    close(masterFD);
+
+    std::cout << (rc ? "PASSED" : "FAILED") << std::endl;
+
+    return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -99,30 +99,59 @@ int16_t IndiSerialWrapper::ReadByte()
     return -1;
 }
 
+//Reads up to length bytes currently available from the serial device into the buffer without blocking.
+//All pending bytes reported by FIONREAD are fetched using a single read.
+size_t IndiSerialWrapper::Read(uint8_t* buffer, size_t length)
+{
+    if(IsOpen() && buffer != nullptr && length > 0)
+    {
+        size_t available = BytesToRead();
+
+        if(available == 0)
+        {
+            return 0;
+        }
+
+        if(available > length)
+        {
+            available = length;
+        }
+
+        int bytesRead = 0;
+        int result = tty_read(mTtyFd, (char*)buffer, (int)available, 0, &bytesRead);
+
+        if(result == TTY_OK && bytesRead > 0)
+        {
+            return (size_t)bytesRead;
+        }
+    }
+
+    return 0;
+}
+
 //writes the buffer to the serial interface.
 //this function should handle all the quirks of various serial interfaces.
-bool IndiSerialWrapper::Write(uint8_t* buffer, size_t offset, size_t length)
+size_t IndiSerialWrapper::Write(const uint8_t* buffer, size_t offset, size_t length)
 {
-    UNUSED(offset);
-    
     {
         std::lock_guard<std::mutex> guard(mMutex);
 
         if(IsOpen() && buffer != nullptr && length > 0)
         {
-            int nbytes_written;
-            int result = tty_write(mTtyFd, (char*)buffer, length, &nbytes_written);
+            int nbytes_written = 0;
+            int result = tty_write(mTtyFd, (const char*)(buffer + offset), length, &nbytes_written);
 
             if(result != TTY_OK)
             {
                 //DEBUG(INDI::Logger::DBG_ERROR,"BresserExosIIDriver::IndiSerialWrapper::Write: error writing to serial device...");
                 //LOG_ERROR("BresserExosIIDriver::IndiSerialWrapper::Write: error writing to serial device...");
-                return false;
             }
-            return true;
+
+            //the bytes written before an error are on the line as well.
+            return nbytes_written > 0 ? (size_t)nbytes_written : 0;
         }
     }
-    return false;
+    return 0;
 }
 
 //flush the buffer.
@@ -60,7 +60,7 @@ class IndiSerialWrapper : public SerialDeviceControl::ISerialInterface
         virtual ~IndiSerialWrapper();
 
         //Get the current device handle.
-        int GetFD();
+        virtual int GetFD();
 
         //Set the device handle.
         void SetFD(int fd);
@@ -80,9 +80,14 @@ class IndiSerialWrapper : public SerialDeviceControl::ISerialInterface
         //Reads a byte from the serial device. Can safely cast to uint8_t unless -1 is returned, corresponding to "stream end reached".
         virtual int16_t ReadByte();
 
+        //Reads up to length bytes currently available from the serial device into the buffer without blocking.
+        //returns the number of bytes read, 0 if no data is available or an error occured.
+        virtual size_t Read(uint8_t* buffer, size_t length);
+
         //writes the buffer to the serial interface.
         //this function should handle all the quirks of various serial interfaces.
-        virtual bool Write(uint8_t* buffer, size_t offset, size_t length);
+        //returns the number of bytes written, less than length if the write failed or was partial.
+        virtual size_t Write(const uint8_t* buffer, size_t offset, size_t length);
 
         //flush the buffer.
         virtual bool Flush();
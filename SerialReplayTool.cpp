@@ -0,0 +1,95 @@
+/*
+ * SerialReplayTool.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+//Feeds a serial capture through the mount control, to reproduce a recorded session or to measure the throughput of the receive path.
+//usage: bresserexos2_replay <capture file> [realtime]
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include "SerialReplayInterface.hpp"
+#include "ExosIIMountControl.hpp"
+
+//timeout waiting for the dispatch thread to consume the replayed bytes after the replay completed, in milliseconds.
+#define REPLAY_DRAIN_TIMEOUT (5000)
+
+typedef TelescopeMountControl::ExosIIMountControl<SerialDeviceControl::SerialReplayInterface> ReplayMountControl;
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <capture file> [realtime]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SerialDeviceControl::SerialReplayMode mode = argc > 2 && strcmp(argv[2], "realtime") == 0 ?
+            SerialDeviceControl::ReplayRealTime : SerialDeviceControl::ReplayAsFastAsPossible;
+
+    SerialDeviceControl::SerialReplayInterface replay(argv[1], mode);
+    ReplayMountControl mount(replay);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    //opened ahead of the reader thread, to fail early on a capture which can not be loaded.
+    if(!replay.Open())
+    {
+        return EXIT_FAILURE;
+    }
+
+    mount.Start();
+
+    bool rc = replay.WaitForCompletion(-1);
+
+    //the replay completes once the bytes are in the pipe, wait for the mount control to process them.
+    SerialDeviceControl::SerialLinkStatistics statistics;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REPLAY_DRAIN_TIMEOUT);
+
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        mount.GetLinkStatistics(statistics);
+    }
+    while(statistics.BytesReceived < replay.GetCapturedReceivedByteCount() && std::chrono::steady_clock::now() < deadline);
+
+    mount.GetLinkStatistics(statistics);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SerialDeviceControl::EquatorialCoordinates coordinates = mount.GetPointingCoordinates();
+    TelescopeMountControl::TelescopeMountState state = mount.GetTelescopeState();
+
+    mount.Stop();
+
+    std::cout << "replayed bytes: " << statistics.BytesReceived << " of " << replay.GetCapturedReceivedByteCount() << " in " << seconds << " s" << std::endl;
+    std::cout << "throughput: " << (statistics.BytesReceived / seconds) << " bytes/s, " << (statistics.FramesReceived / seconds) << " frames/s" << std::endl;
+    std::cout << "frames received: " << statistics.FramesReceived << " junk bytes: " << statistics.JunkBytes
+              << " overflow bytes: " << statistics.OverflowBytes << " nan payloads: " << statistics.NaNPayloads << std::endl;
+    std::cout << "final state: " << (int)state << " RA: " << coordinates.RightAscension << " DEC: " << coordinates.Declination << std::endl;
+    std::cout << mount.GetReadToDecodeLatency().ToString("read -> decoded") << std::endl;
+    std::cout << mount.GetDecodeToStoredLatency().ToString("decoded -> stored") << std::endl;
+
+    return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,414 @@
+/*
+ * SimulatedMountExercise.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+//Runs the mount control against the simulated handbox, without telescope and indi server.
+//usage: bresserexos2_simulation [right ascension (hours)] [declination (degrees)] [capture file]
+
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <poll.h>
+
+#include "SimulatedHandbox.hpp"
+#include "ExosIIMountControl.hpp"
+#include "PulseGuideEngine.hpp"
+#include "GuideRateCalibrator.hpp"
+#include "PointingEstimator.hpp"
+
+//timeout waiting for the connection in milliseconds.
+#define EXERCISE_CONNECT_TIMEOUT (5000)
+
+//timeout waiting for slews to finish in milliseconds.
+#define EXERCISE_SLEW_TIMEOUT (180000)
+
+//interval the pointing estimate is compared with the simulated axes in milliseconds.
+#define EXERCISE_ESTIMATE_SAMPLE_INTERVAL (50)
+
+//number of pulses on each axis measured by the guide calibration.
+#define EXERCISE_CALIBRATION_PULSES (3)
+
+//duration of the pulses measured by the guide calibration in milliseconds.
+#define EXERCISE_CALIBRATION_PULSE_DURATION (400)
+
+//duration of the long pulses measured by the second guide calibration in milliseconds,
+//both axes send frames long enough to saturate the line if the pulses were not paced.
+#define EXERCISE_LONG_CALIBRATION_PULSE_DURATION (2000)
+
+//relative deviation of the rates measured by both guide calibrations, which is accepted.
+#define EXERCISE_CALIBRATION_TOLERANCE (0.05)
+
+typedef TelescopeMountControl::ExosIIMountControl<SerialDeviceControl::SimulatedHandbox> SimulatedMountControl;
+
+typedef TelescopeMountControl::PulseGuideEngine<SimulatedMountControl> SimulatedGuideEngine;
+
+//wait until the mount reaches the state provided, returns the milliseconds waited or -1 on timeout.
+static long WaitForState(SimulatedMountControl &mount, TelescopeMountControl::TelescopeMountState state, long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while(mount.GetTelescopeState() != state)
+    {
+        long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed > timeoutMilliseconds)
+        {
+            return -1;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//wait until the guide engine completed the number of pulses provided, returns the milliseconds waited or -1 on timeout.
+static long WaitForGuidePulses(SimulatedGuideEngine &engine, size_t pulseCount, long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TelescopeMountControl::GuidePulseCompletion completion;
+
+    while(pulseCount > 0)
+    {
+        long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed > timeoutMilliseconds)
+        {
+            return -1;
+        }
+
+        struct pollfd descriptor;
+        descriptor.fd = engine.GetCompletionFD();
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+
+        poll(&descriptor, 1, (int)(timeoutMilliseconds - elapsed));
+
+        while(pulseCount > 0 && engine.PopCompletion(completion))
+        {
+            std::cout << "guide pulse: requested " << completion.RequestedMilliseconds << " ms executed "
+                      << completion.ExecutedMilliseconds << " ms" << std::endl;
+            pulseCount--;
+        }
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//pulse north and east at the same time until both axes are calibrated, feeding the calibrator like the driver does.
+//returns the milliseconds waited or -1 on timeout.
+static long CalibrateGuideRates(SimulatedMountControl &mount, SimulatedGuideEngine &engine, TelescopeMountControl::GuideRateCalibrator &calibrator,
+                                uint32_t pulseMilliseconds, long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastPositionTime;
+    TelescopeMountControl::GuidePulseCompletion completion;
+    size_t pulsesMeasured = 0;
+    bool isPulsing = false;
+
+    while(pulsesMeasured < EXERCISE_CALIBRATION_PULSES)
+    {
+        long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed > timeoutMilliseconds)
+        {
+            return -1;
+        }
+
+        if(!isPulsing)
+        {
+            engine.Pulse(SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID, pulseMilliseconds);
+            engine.Pulse(SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID, pulseMilliseconds);
+            isPulsing = true;
+        }
+
+        while(engine.PopCompletion(completion))
+        {
+            if(completion.FramesDropped > 0)
+            {
+                std::cout << "guide pulse: " << completion.FramesDropped << " frames dropped" << std::endl;
+            }
+
+            calibrator.AddPulse(completion);
+        }
+
+        TelescopeMountControl::MountSnapshot snapshot = mount.GetMountSnapshot();
+
+        if(snapshot.RawCoordinates.TimeStamp != lastPositionTime)
+        {
+            lastPositionTime = snapshot.RawCoordinates.TimeStamp;
+
+            //the next pulses start once both axes were measured.
+            if(calibrator.AddPosition(snapshot.RawCoordinates) &&
+                    calibrator.GetCalibration(TelescopeMountControl::GuideAxis::DeclinationAxis).SampleCount > pulsesMeasured &&
+                    calibrator.GetCalibration(TelescopeMountControl::GuideAxis::RightAscensionAxis).SampleCount > pulsesMeasured)
+            {
+                pulsesMeasured++;
+                isPulsing = false;
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    TelescopeMountControl::GuideAxisCalibration declination = calibrator.GetCalibration(TelescopeMountControl::GuideAxis::DeclinationAxis);
+    TelescopeMountControl::GuideAxisCalibration rightAscension = calibrator.GetCalibration(TelescopeMountControl::GuideAxis::RightAscensionAxis);
+
+    std::cout << "guide rate N/S: " << declination.ArcsecondsPerFrame << " arcsec/frame lag " << declination.LagMilliseconds << " ms" << std::endl;
+    std::cout << "guide rate W/E: " << rightAscension.ArcsecondsPerFrame << " arcsec/frame lag " << rightAscension.LagMilliseconds << " ms" << std::endl;
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//distance between the positions in arc seconds, right ascension measured along the axis.
+static double PointingError(float rightAscension, float declination, float actualRightAscension, float actualDeclination)
+{
+    double rightAscensionError = std::remainder((double)rightAscension - actualRightAscension, 24.0) * 54000.0;
+    double declinationError = ((double)declination - actualDeclination) * 3600.0;
+
+    return std::sqrt(rightAscensionError * rightAscensionError + declinationError * declinationError);
+}
+
+//wait until the simulated axes stopped, comparing the reported and the estimated position with the simulated axes meanwhile.
+//returns the milliseconds waited or -1 on timeout.
+static long WaitForSlewFinishedEstimating(SimulatedMountControl &mount, SerialDeviceControl::SimulatedHandbox &handbox, long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastReportTime;
+    TelescopeMountControl::PointingEstimator estimator;
+    double reportedErrorSum = 0.0;
+    double estimatedErrorSum = 0.0;
+    size_t withinUncertainty = 0;
+    size_t samples = 0;
+
+    while(handbox.IsSlewing())
+    {
+        long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed > timeoutMilliseconds)
+        {
+            return -1;
+        }
+
+        TelescopeMountControl::MountSnapshot snapshot = mount.GetMountSnapshot();
+
+        if(snapshot.Coordinates.TimeStamp != lastReportTime)
+        {
+            lastReportTime = snapshot.Coordinates.TimeStamp;
+            estimator.AddReport(snapshot.Coordinates);
+        }
+
+        TelescopeMountControl::PointingEstimate estimate = estimator.Predict(std::chrono::steady_clock::now());
+
+        float actualRightAscension;
+        float actualDeclination;
+        handbox.GetPointingCoordinates(actualRightAscension, actualDeclination);
+
+        if(estimate.IsValid)
+        {
+            double estimatedError = PointingError(estimate.Coordinates.RightAscension, estimate.Coordinates.Declination,
+                                                  actualRightAscension, actualDeclination);
+
+            reportedErrorSum += PointingError(snapshot.Coordinates.RightAscension, snapshot.Coordinates.Declination,
+                                              actualRightAscension, actualDeclination);
+            estimatedErrorSum += estimatedError;
+
+            double uncertainty = std::sqrt(estimate.RightAscensionUncertainty * estimate.RightAscensionUncertainty +
+                                           estimate.DeclinationUncertainty * estimate.DeclinationUncertainty);
+
+            if(estimatedError <= uncertainty)
+            {
+                withinUncertainty++;
+            }
+
+            samples++;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(EXERCISE_ESTIMATE_SAMPLE_INTERVAL));
+    }
+
+    if(samples > 0)
+    {
+        std::cout << "slew pointing error: reported " << reportedErrorSum / samples << " arcsec, estimated " << estimatedErrorSum / samples
+                  << " arcsec, within uncertainty " << (100 * withinUncertainty) / samples << " % of " << samples << " samples" << std::endl;
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//returns true if both calibrations measured the same rate on both axes, within the tolerance.
+static bool CompareGuideRates(TelescopeMountControl::GuideRateCalibrator &first, TelescopeMountControl::GuideRateCalibrator &second)
+{
+    bool rc = true;
+    TelescopeMountControl::GuideAxis axes[] = {TelescopeMountControl::GuideAxis::DeclinationAxis, TelescopeMountControl::GuideAxis::RightAscensionAxis};
+
+    for(TelescopeMountControl::GuideAxis axis : axes)
+    {
+        double firstRate = first.GetCalibration(axis).ArcsecondsPerFrame;
+        double secondRate = second.GetCalibration(axis).ArcsecondsPerFrame;
+        double deviation = std::fabs(secondRate - firstRate) / std::fabs(firstRate);
+
+        std::cout << "guide rate deviation " << (axis == TelescopeMountControl::GuideAxis::DeclinationAxis ? "N/S: " : "W/E: ")
+                  << deviation * 100.0 << " %" << std::endl;
+
+        rc = rc && deviation <= EXERCISE_CALIBRATION_TOLERANCE;
+    }
+
+    return rc;
+}
+
+//update the site location and wait until it was read back, returns the milliseconds waited or -1 on timeout or a state change.
+static long UpdateSiteLocation(SimulatedMountControl &mount, float latitude, float longitude, long timeoutMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TelescopeMountControl::TelescopeMountState state = mount.GetTelescopeState();
+
+    mount.SetSiteLocation(latitude, longitude);
+
+    while(mount.GetSiteLocation().RightAscension != latitude || mount.GetSiteLocation().Declination != longitude)
+    {
+        long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed > timeoutMilliseconds)
+        {
+            return -1;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    //the read back must not change the state of the mount.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    if(mount.GetTelescopeState() != state)
+    {
+        std::cout << "site location changed the state to " << SimulatedMountControl::StateToString(mount.GetTelescopeState()) << std::endl;
+        return -1;
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool Step(const char* name, long elapsed)
+{
+    if(elapsed < 0)
+    {
+        std::cout << name << ": timeout!" << std::endl;
+        return false;
+    }
+
+    std::cout << name << ": " << elapsed << " ms" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    float rightAscension = argc > 1 ? (float)atof(argv[1]) : 5.5f;
+    float declination = argc > 2 ? (float)atof(argv[2]) : 20.0f;
+
+    SerialDeviceControl::SimulatedHandbox handbox;
+
+    SimulatedMountControl mount(handbox);
+
+    SimulatedGuideEngine guideEngine(mount);
+
+    if(argc > 3 && !mount.StartCapture(argv[3]))
+    {
+        return EXIT_FAILURE;
+    }
+
+    mount.Start();
+    mount.SetSiteLocation(52.5f, 13.4f);
+
+    bool rc = Step("connect", WaitForState(mount, TelescopeMountControl::TelescopeMountState::Parked, EXERCISE_CONNECT_TIMEOUT));
+    rc = rc && Step("site location", UpdateSiteLocation(mount, 48.1f, 11.6f, EXERCISE_CONNECT_TIMEOUT));
+
+    if(rc)
+    {
+        mount.GoTo(rightAscension, declination);
+        rc = Step("goto slewing", WaitForState(mount, TelescopeMountControl::TelescopeMountState::Slewing, EXERCISE_CONNECT_TIMEOUT)) &&
+             Step("goto tracking", WaitForState(mount, TelescopeMountControl::TelescopeMountState::Tracking, EXERCISE_SLEW_TIMEOUT)) &&
+             Step("goto target reached", WaitForSlewFinishedEstimating(mount, handbox, EXERCISE_SLEW_TIMEOUT));
+    }
+
+    if(rc)
+    {
+        mount.StartMotionToDirection(SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID, 10);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        mount.StopMotionToDirection();
+
+        rc = Step("move north", WaitForState(mount, TelescopeMountControl::TelescopeMountState::Tracking, EXERCISE_CONNECT_TIMEOUT));
+    }
+
+    if(rc)
+    {
+        //pulses on both axes at the same time.
+        guideEngine.Start();
+        guideEngine.Pulse(SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID, 250);
+        guideEngine.Pulse(SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID, 130);
+
+        rc = Step("pulse guide", WaitForGuidePulses(guideEngine, 2, EXERCISE_CONNECT_TIMEOUT));
+
+        //the calibrator did not see the pulses above, let their motion settle before measuring.
+        std::this_thread::sleep_for(std::chrono::milliseconds(GUIDE_CALIBRATION_SETTLE_TIME));
+
+        TelescopeMountControl::GuideRateCalibrator calibrator;
+        rc = rc && Step("guide calibration", CalibrateGuideRates(mount, guideEngine, calibrator, EXERCISE_CALIBRATION_PULSE_DURATION,
+                        EXERCISE_SLEW_TIMEOUT));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(GUIDE_CALIBRATION_SETTLE_TIME));
+
+        //long pulses on both axes at the same time have to measure the same rates.
+        TelescopeMountControl::GuideRateCalibrator longCalibrator;
+        rc = rc && Step("long guide calibration", CalibrateGuideRates(mount, guideEngine, longCalibrator, EXERCISE_LONG_CALIBRATION_PULSE_DURATION,
+                        EXERCISE_SLEW_TIMEOUT)) && CompareGuideRates(calibrator, longCalibrator);
+
+        guideEngine.Stop();
+    }
+
+    if(rc)
+    {
+        mount.ParkPosition();
+        rc = Step("park", WaitForState(mount, TelescopeMountControl::TelescopeMountState::Parked, EXERCISE_SLEW_TIMEOUT));
+    }
+
+    mount.Stop();
+    mount.StopCapture();
+
+    SerialDeviceControl::SerialLinkStatistics statistics;
+    mount.GetLinkStatistics(statistics);
+
+    std::cout << "bytes received: " << statistics.BytesReceived << " sent: " << statistics.BytesSent << std::endl;
+    std::cout << "frames received: " << statistics.FramesReceived << " junk bytes: " << statistics.JunkBytes
+              << " overflow bytes: " << statistics.OverflowBytes << std::endl;
+    std::cout << "write failures: " << statistics.WriteFailures << " rejected frames: " << statistics.RejectedFrames << std::endl;
+    std::cout << "handbox commands: " << handbox.GetValidCommandCount() << " invalid: " << handbox.GetInvalidCommandCount()
+              << " reports: " << handbox.GetReportCount() << " dropped: " << handbox.GetDroppedReportCount() << std::endl;
+    std::cout << mount.GetReadToDecodeLatency().ToString("read -> decoded") << std::endl;
+    std::cout << mount.GetDecodeToStoredLatency().ToString("decoded -> stored") << std::endl;
+    std::cout << mount.GetMotionCadenceJitter().ToString("motion command lateness") << std::endl;
+    std::cout << "motion commands skipped: " << mount.GetSkippedMotionCommandCount() << std::endl;
+
+    return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,230 @@
+/*
+ * AsyncStateNotifier.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _ASYNCSTATENOTIFIER_H_INCLUDED_
+#define _ASYNCSTATENOTIFIER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include "config.h"
+
+#include "StateMachine.hpp"
+#include "MpscRingBuffer.hpp"
+#include "EventNotifier.hpp"
+
+namespace TelescopeMountControl
+{
+//A transition reported by a state machine.
+template<typename StateType, typename SignalType>
+struct StateTransitionEvent
+{
+    StateType FromState;
+    SignalType Signal;
+    StateType ToState;
+
+    //true if the transition was undefined, and the machine entered its error state.
+    bool IsError;
+};
+
+//State notification queueing the transitions, and delivering them to the subscribers on a separate thread.
+//The state machine calls it instead of the subscribers, so slow subscribers (logging, indi updates) never delay the thread doing the transition.
+//Queueing is lock free and does not block, if the notifier falls behind by more than the capacity, events are dropped and counted.
+//Instead of starting the notifier thread, the owner may deliver the events periodically on a thread of its choice (e.g. the indi event loop) using Dispatch.
+template<typename StateType, typename SignalType, size_t capacity>
+class AsyncStateNotifier : public IStateNotification<StateType, SignalType>
+{
+        typedef StateTransitionEvent<StateType, SignalType> EventType;
+
+    public:
+        AsyncStateNotifier() :
+            mThreadRunning(false),
+            mConsumerWaiting(false)
+        {
+
+        }
+
+        virtual ~AsyncStateNotifier()
+        {
+            Stop();
+        }
+
+        //Add a subscriber, the subscribers have to be added before the events are delivered.
+        void Subscribe(IStateNotification<StateType, SignalType> &subscriber)
+        {
+            mSubscribers.push_back(&subscriber);
+        }
+
+        //Start the thread delivering the events.
+        bool Start()
+        {
+            if(mThreadRunning.load())
+            {
+                return false;
+            }
+
+            mStopEvent.Clear();
+            mThreadRunning.store(true);
+            mNotifierThread = std::thread(&AsyncStateNotifier::NotifierThreadFunction, this);
+
+            return true;
+        }
+
+        //Stop the notifier thread, the events queued until then are still delivered.
+        void Stop()
+        {
+            if(!mThreadRunning.load())
+            {
+                return;
+            }
+
+            mThreadRunning.store(false);
+            mStopEvent.Signal();
+            mNotifierThread.join();
+
+            Dispatch();
+        }
+
+        //Called by the state machine, queue the transition.
+        virtual void OnTransitionChanged(StateType fromState, SignalType signal, StateType toState)
+        {
+            EventType event;
+            event.FromState = fromState;
+            event.Signal = signal;
+            event.ToState = toState;
+            event.IsError = false;
+
+            Queue(event);
+        }
+
+        //Called by the state machine, queue the undefined transition.
+        virtual void OnErrorStateReached(StateType fromState, SignalType signal)
+        {
+            EventType event;
+            event.FromState = fromState;
+            event.Signal = signal;
+            event.ToState = fromState;
+            event.IsError = true;
+
+            Queue(event);
+        }
+
+        //Deliver the queued events to the subscribers on the calling thread, returns the number of events delivered.
+        //Only one thread may deliver events at a time, i.e. either the notifier thread is running or the owner calls this function.
+        size_t Dispatch()
+        {
+            EventType event;
+            size_t count = 0;
+
+            while(mEvents.Pop(event))
+            {
+                for(size_t i = 0; i < mSubscribers.size(); i++)
+                {
+                    if(event.IsError)
+                    {
+                        mSubscribers[i]->OnErrorStateReached(event.FromState, event.Signal);
+                    }
+                    else
+                    {
+                        mSubscribers[i]->OnTransitionChanged(event.FromState, event.Signal, event.ToState);
+                    }
+                }
+
+                count++;
+            }
+
+            return count;
+        }
+
+        //Returns the number of events dropped since the notifier fell behind.
+        uint64_t GetDroppedEventCount()
+        {
+            return mEvents.GetDroppedCount();
+        }
+
+    private:
+        //the subscribers, not modified while events are delivered.
+        std::vector<IStateNotification<StateType, SignalType>*> mSubscribers;
+
+        //the queued events.
+        SerialDeviceControl::MpscRingBuffer<EventType, capacity> mEvents;
+
+        //signaled when events are queued while the consumer waits.
+        SerialDeviceControl::EventNotifier mQueuedEvent;
+
+        //signaled to stop the notifier thread.
+        SerialDeviceControl::EventNotifier mStopEvent;
+
+        std::thread mNotifierThread;
+
+        std::atomic<bool> mThreadRunning;
+
+        //set by the consumer before it waits, so producers only signal if the consumer actually sleeps.
+        std::atomic<bool> mConsumerWaiting;
+
+        void Queue(const EventType &event)
+        {
+            if(mEvents.Push(event) && mConsumerWaiting.exchange(false))
+            {
+                mQueuedEvent.Signal();
+            }
+        }
+
+        //Loop of the notifier thread.
+        void NotifierThreadFunction()
+        {
+            while(mThreadRunning.load())
+            {
+                Dispatch();
+
+                //announce the wait, then check again, so an event queued in between is not missed.
+                mConsumerWaiting.store(true);
+
+                if(Dispatch() > 0)
+                {
+                    mConsumerWaiting.store(false);
+                    continue;
+                }
+
+                struct pollfd descriptors[2];
+
+                descriptors[0].fd = mQueuedEvent.GetFD();
+                descriptors[0].events = POLLIN;
+                descriptors[0].revents = 0;
+
+                descriptors[1].fd = mStopEvent.GetFD();
+                descriptors[1].events = POLLIN;
+                descriptors[1].revents = 0;
+
+                poll(descriptors, 2, -1);
+
+                mQueuedEvent.Clear();
+                mConsumerWaiting.store(false);
+            }
+        }
+};
+}
+#endif
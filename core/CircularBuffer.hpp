@@ -0,0 +1,262 @@
+/*
+ * CircularBuffer.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _CIRCULARBUFFER_H_INCLUDED_
+#define _CIRCULARBUFFER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "config.h"
+
+namespace SerialDeviceControl
+{
+//Contiguous piece of buffer storage.
+template<typename T>
+struct BufferSegment
+{
+    //first element of the segment.
+    T* Data;
+
+    //number of elements in the segment.
+    size_t Length;
+};
+
+//A ring buffer view consists of at most two contiguous segments, the second one is empty unless the view wraps around.
+template<typename T>
+struct BufferSegments
+{
+    BufferSegment<T> First;
+
+    BufferSegment<T> Second;
+
+    //total number of elements of both segments.
+    size_t Length() const
+    {
+        return First.Length + Second.Length;
+    }
+};
+
+//Ring buffer with a power of two capacity.
+//The read and write positions run freely and are masked on access, so there are no wrap around branches
+//and a full buffer is distinguishable from an empty one without an extra counter.
+//Bulk operations copy at most two contiguous segments.
+template<typename T, size_t capacity>
+class CircularBuffer
+{
+        static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "the capacity has to be a power of two.");
+
+        static const size_t IndexMask = capacity - 1;
+
+    public:
+        CircularBuffer() :
+            mHead(0),
+            mTail(0)
+        {
+
+        }
+
+        virtual ~CircularBuffer()
+        {
+
+        }
+
+        //maximum number of elements the buffer can hold.
+        static size_t Capacity()
+        {
+            return capacity;
+        }
+
+        //number of elements stored.
+        size_t Size()
+        {
+            return mTail - mHead;
+        }
+
+        //number of elements which can be added until the buffer is full.
+        size_t Free()
+        {
+            return capacity - Size();
+        }
+
+        bool IsEmpty()
+        {
+            return mTail == mHead;
+        }
+
+        bool IsFull()
+        {
+            return Size() == capacity;
+        }
+
+        //drop all stored elements.
+        void Clear()
+        {
+            mHead = mTail;
+        }
+
+        //append a single value, returns false if the buffer is full.
+        bool PushBack(T value)
+        {
+            if(IsFull())
+            {
+                return false;
+            }
+
+            mBuffer[mTail & IndexMask] = value;
+            mTail++;
+
+            return true;
+        }
+
+        //remove the front value and return it, returns false if the buffer is empty.
+        bool PopFront(T &returnValue)
+        {
+            if(IsEmpty())
+            {
+                return false;
+            }
+
+            returnValue = mBuffer[mHead & IndexMask];
+            mHead++;
+
+            return true;
+        }
+
+        //return the front value without removing it, returns false if the buffer is empty.
+        bool Front(T &returnValue)
+        {
+            if(IsEmpty())
+            {
+                return false;
+            }
+
+            returnValue = mBuffer[mHead & IndexMask];
+
+            return true;
+        }
+
+        //access the value at the logical position counted from the front, without removing it.
+        //the index has to be less than Size().
+        T At(size_t logicalIndex)
+        {
+            return mBuffer[(mHead + logicalIndex) & IndexMask];
+        }
+
+        //append up to count values, returns the number of values added, which is less than count if the buffer runs full.
+        size_t Write(const T* values, size_t count)
+        {
+            BufferSegments<T> segments = WritableSegments();
+
+            count = std::min(count, segments.Length());
+
+            size_t firstLength = std::min(count, segments.First.Length);
+
+            std::copy(values, values + firstLength, segments.First.Data);
+            std::copy(values + firstLength, values + count, segments.Second.Data);
+
+            mTail += count;
+
+            return count;
+        }
+
+        //copy up to count values starting at the logical offset from the front, without removing them.
+        //returns the number of values copied.
+        size_t Peek(size_t offset, T* values, size_t count)
+        {
+            BufferSegments<T> segments = ReadableSegments(offset);
+
+            count = std::min(count, segments.Length());
+
+            size_t firstLength = std::min(count, segments.First.Length);
+
+            std::copy(segments.First.Data, segments.First.Data + firstLength, values);
+            std::copy(segments.Second.Data, segments.Second.Data + (count - firstLength), values + firstLength);
+
+            return count;
+        }
+
+        //drop up to count values from the front, returns the number of values dropped.
+        size_t Consume(size_t count)
+        {
+            count = std::min(count, Size());
+
+            mHead += count;
+
+            return count;
+        }
+
+        //the stored values starting at the logical offset from the front, for in place processing.
+        BufferSegments<T> ReadableSegments(size_t offset = 0)
+        {
+            offset = std::min(offset, Size());
+
+            return MakeSegments(mHead + offset, Size() - offset);
+        }
+
+        //the free storage behind the last value, to be filled in place and then added using Commit.
+        BufferSegments<T> WritableSegments()
+        {
+            return MakeSegments(mTail, Free());
+        }
+
+        //add count values written in place to the storage returned by WritableSegments.
+        //returns the number of values added.
+        size_t Commit(size_t count)
+        {
+            count = std::min(count, Free());
+
+            mTail += count;
+
+            return count;
+        }
+
+    private:
+        //free running position of the first stored element.
+        size_t mHead;
+
+        //free running position behind the last stored element.
+        size_t mTail;
+
+        T mBuffer[capacity];
+
+        //split the range of count elements starting at the free running position into its contiguous parts.
+        BufferSegments<T> MakeSegments(size_t position, size_t count)
+        {
+            size_t start = position & IndexMask;
+            size_t firstLength = std::min(count, capacity - start);
+
+            BufferSegments<T> segments;
+
+            segments.First.Data = &mBuffer[start];
+            segments.First.Length = firstLength;
+
+            segments.Second.Data = &mBuffer[0];
+            segments.Second.Length = count - firstLength;
+
+            return segments;
+        }
+};
+}
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * CriticalData.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _CRITICALDATA_H_INCLUDED_
+#define _CRITICALDATA_H_INCLUDED_
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include "config.h"
+
+//largest type in bytes kept in a seqlock, larger types are protected by a mutex.
+#define CRITICAL_DATA_SEQLOCK_MAXIMUM_SIZE (64)
+
+namespace SerialDeviceControl
+{
+//How the contained value of a CriticalData is protected.
+enum CriticalDataStorage
+{
+    //any type, Get and Set lock a mutex.
+    MutexStorage = 0,
+    //trivially copyable types of 1, 2, 4 or 8 bytes, kept in a std::atomic.
+    AtomicStorage = 1,
+    //small trivially copyable types, kept in a seqlock, readers never block writers.
+    SeqLockStorage = 2
+};
+
+//Selects the storage of a type, the cheapest protection applicable.
+template<typename T>
+struct CriticalDataTraits
+{
+    static const bool IsWord = std::is_trivially_copyable<T>::value &&
+                               (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+    static const bool IsSmall = std::is_trivially_copyable<T>::value && sizeof(T) <= CRITICAL_DATA_SEQLOCK_MAXIMUM_SIZE;
+
+    static const CriticalDataStorage Storage = IsWord ? AtomicStorage : (IsSmall ? SeqLockStorage : MutexStorage);
+};
+
+//simple mutex container, protecting its content from concurrently access and its side effects.
+//intended for simple data types.
+//Small trivially copyable types use the lock free specializations below, with the same interface.
+template<typename T, CriticalDataStorage storage = CriticalDataTraits<T>::Storage>
+class CriticalData
+{
+    public:
+        //default constructure, leaves the contained object uninitialized.
+        CriticalData()
+        {
+
+        }
+
+        //constructor setting the contained object to the initial value.
+        CriticalData(T initialValue) :
+            mData(initialValue)
+        {
+
+        }
+
+        virtual ~CriticalData()
+        {
+
+        }
+
+        //return the value of the contained data object.
+        T Get()
+        {
+            T val;
+
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+                val = mData;
+            }
+
+            return val;
+
+        }
+
+        //set the value of the contained data object.
+        void Set(T value)
+        {
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+                mData = value;
+            }
+        }
+
+    private:
+        //instance of the data type.
+        T mData;
+        //mutex protecting the data object.
+        std::mutex mMutex;
+};
+
+//Values fitting a machine word (e.g. the running flags polled by the threads on every iteration) are kept in an atomic.
+template<typename T>
+class CriticalData<T, AtomicStorage>
+{
+    public:
+        //default constructure, leaves the contained object uninitialized.
+        CriticalData()
+        {
+
+        }
+
+        //constructor setting the contained object to the initial value.
+        CriticalData(T initialValue) :
+            mData(initialValue)
+        {
+
+        }
+
+        virtual ~CriticalData()
+        {
+
+        }
+
+        //return the value of the contained data object.
+        T Get()
+        {
+            return mData.load(std::memory_order_acquire);
+        }
+
+        //set the value of the contained data object.
+        void Set(T value)
+        {
+            mData.store(value, std::memory_order_release);
+        }
+
+    private:
+        //instance of the data type.
+        std::atomic<T> mData;
+};
+
+//Small structs (e.g. the pointing coordinates polled by the indi thread) are kept in a seqlock.
+//A writer makes the sequence odd while it updates the value, readers retry until they copied the value with an even, unchanged sequence.
+//Writers are serialized by claiming the sequence with a compare and swap, readers never block and never write.
+//The value is stored in relaxed atomic words, so the copies racing with a writer are well defined.
+template<typename T>
+class CriticalData<T, SeqLockStorage>
+{
+        static const size_t WordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    public:
+        //default constructure, leaves the contained object zero initialized.
+        CriticalData() :
+            mSequence(0)
+        {
+            for(size_t i = 0; i < WordCount; i++)
+            {
+                mWords[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        //constructor setting the contained object to the initial value.
+        CriticalData(T initialValue) :
+            mSequence(0)
+        {
+            Store(initialValue);
+        }
+
+        virtual ~CriticalData()
+        {
+
+        }
+
+        //return the value of the contained data object.
+        T Get()
+        {
+            uint64_t words[WordCount];
+            size_t sequence;
+
+            while(true)
+            {
+                sequence = mSequence.load(std::memory_order_acquire);
+
+                if((sequence & 1) != 0)
+                {
+                    //a writer is active.
+                    continue;
+                }
+
+                for(size_t i = 0; i < WordCount; i++)
+                {
+                    words[i] = mWords[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if(mSequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    break;
+                }
+            }
+
+            T value;
+            memcpy(&value, words, sizeof(T));
+
+            return value;
+        }
+
+        //set the value of the contained data object.
+        void Set(T value)
+        {
+            size_t sequence = mSequence.load(std::memory_order_relaxed);
+
+            //claim the sequence, another writer holds it while it is odd.
+            while((sequence & 1) != 0 ||
+                    !mSequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                sequence = mSequence.load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Store(value);
+
+            mSequence.store(sequence + 2, std::memory_order_release);
+        }
+
+    private:
+        //even while the value is stable, odd while a writer updates it.
+        std::atomic<size_t> mSequence;
+
+        //the value, split into words.
+        std::atomic<uint64_t> mWords[WordCount];
+
+        //copy the value into the words.
+        void Store(const T &value)
+        {
+            uint64_t words[WordCount] = {0};
+            memcpy(words, &value, sizeof(T));
+
+            for(size_t i = 0; i < WordCount; i++)
+            {
+                mWords[i].store(words[i], std::memory_order_relaxed);
+            }
+        }
+};
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * EventNotifier.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "EventNotifier.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+using SerialDeviceControl::EventNotifier;
+
+EventNotifier::EventNotifier() :
+    mReadFD(-1),
+    mWriteFD(-1)
+{
+#ifdef __linux__
+    mReadFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    mWriteFD = mReadFD;
+#else
+    int pipeFDs[2];
+
+    if(pipe(pipeFDs) == 0)
+    {
+        fcntl(pipeFDs[0], F_SETFL, fcntl(pipeFDs[0], F_GETFL) | O_NONBLOCK);
+        fcntl(pipeFDs[1], F_SETFL, fcntl(pipeFDs[1], F_GETFL) | O_NONBLOCK);
+        fcntl(pipeFDs[0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipeFDs[1], F_SETFD, FD_CLOEXEC);
+
+        mReadFD = pipeFDs[0];
+        mWriteFD = pipeFDs[1];
+    }
+#endif
+}
+
+EventNotifier::~EventNotifier()
+{
+    if(mWriteFD > -1 && mWriteFD != mReadFD)
+    {
+        close(mWriteFD);
+    }
+
+    if(mReadFD > -1)
+    {
+        close(mReadFD);
+    }
+}
+
+int EventNotifier::GetFD()
+{
+    return mReadFD;
+}
+
+bool EventNotifier::Signal()
+{
+    if(mWriteFD < 0)
+    {
+        return false;
+    }
+
+#ifdef __linux__
+    uint64_t increment = 1;
+    ssize_t result = write(mWriteFD, &increment, sizeof(increment));
+#else
+    uint8_t token = 1;
+    ssize_t result = write(mWriteFD, &token, sizeof(token));
+#endif
+    //a full pipe or a saturated counter still leaves the event signaled.
+    return result > 0 || errno == EAGAIN;
+}
+
+void EventNotifier::Clear()
+{
+    if(mReadFD < 0)
+    {
+        return;
+    }
+
+    uint64_t drain[8];
+
+    //eventfd resets with a single read, the pipe needs to be drained completely.
+    while(read(mReadFD, drain, sizeof(drain)) > 0)
+    {
+    }
+}
+
+bool EventNotifier::Wait(int timeoutMilliseconds)
+{
+    if(mReadFD < 0)
+    {
+        return false;
+    }
+
+    struct pollfd descriptor;
+    descriptor.fd = mReadFD;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+
+    int result;
+
+    do
+    {
+        result = poll(&descriptor, 1, timeoutMilliseconds);
+    }
+    while(result < 0 && errno == EINTR);
+
+    return result > 0 && (descriptor.revents & POLLIN);
+}
@@ -0,0 +1,69 @@
+/*
+ * EventNotifier.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _EVENTNOTIFIER_H_INCLUDED_
+#define _EVENTNOTIFIER_H_INCLUDED_
+
+#include <cstdint>
+#include "config.h"
+
+namespace SerialDeviceControl
+{
+//Pollable wake up event, used to interrupt threads blocking in poll() without any periodic wake ups.
+//Uses an eventfd on linux and falls back to a self pipe on other platforms.
+class EventNotifier
+{
+    public:
+        //Creates the underlying event descriptor(s).
+        EventNotifier();
+
+        //Closes the underlying event descriptor(s).
+        virtual ~EventNotifier();
+
+        //Returns the descriptor to be added to a poll set, it becomes readable when the event is signaled.
+        int GetFD();
+
+        //Signal the event, any thread polling the descriptor wakes up.
+        //returns false if the event could not be signaled.
+        bool Signal();
+
+        //Reset the event to the non signaled state, so it can be reused.
+        void Clear();
+
+        //Blocks until the event is signaled or the timeout in milliseconds elapsed, a negative timeout waits forever.
+        //returns true if the event was signaled.
+        bool Wait(int timeoutMilliseconds);
+
+    private:
+        //descriptor polled by the consumer.
+        int mReadFD;
+
+        //descriptor written to signal the event, equals mReadFD for eventfd.
+        int mWriteFD;
+
+        //no copies, the descriptors are owned by this instance.
+        EventNotifier(const EventNotifier&);
+        EventNotifier& operator=(const EventNotifier&);
+};
+}
+#endif
@@ -31,18 +31,28 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <chrono>
 #include "config.h"
 
 #include "StateMachine.hpp"
+#include "AsyncStateNotifier.hpp"
 #include "CriticalData.hpp"
+#include "SnapshotBuffer.hpp"
 #include "SerialCommand.hpp"
 #include "SerialCommandTransceiver.hpp"
 #include "INotifyPointingCoordinatesReceived.hpp"
+#include "LatencyHistogram.hpp"
 
 //The manual states a tracking speed for 0.004°/s everything above is 
 //considered slewing.
 #define TRACK_SLEW_THRESHOLD (0.0045)
 
+//number of state transitions queued until the notifier thread has to catch up, has to be a power of two.
+#define MOUNT_STATE_EVENT_QUEUE_SIZE (64)
+
+//number of mount snapshots kept, a reader only retries if this many snapshots are published while it copies one.
+#define MOUNT_SNAPSHOT_SLOT_COUNT (4)
+
 #define EXPR_TO_STRING(x) #x
 
 namespace TelescopeMountControl
@@ -115,7 +125,9 @@ enum TelescopeSignals
 };
 
 //type definition of the state machine type for convinience.
-typedef StateMachine<TelescopeMountState, TelescopeSignals, IStateNotification<TelescopeMountState, TelescopeSignals>>
+//the states and signals are dense enums, so the transitions are kept in a flat table and the state is read lock free.
+typedef DenseStateMachine<TelescopeMountState, TelescopeSignals, IStateNotification<TelescopeMountState, TelescopeSignals>,
+        TelescopeMountState::FailSafe + 1, TelescopeSignals::Connect, TelescopeSignals::INVALID - TelescopeSignals::Connect + 1>
         MountStateMachine;
 
 //store the motion state while tracking.
@@ -127,6 +139,38 @@ struct MotionState
     uint16_t CommandsPerSecond;
 };
 
+//timing of the pointing coordinates stored last.
+struct PointingTiming
+{
+    //the frame carrying the coordinates was read from the serial device.
+    std::chrono::steady_clock::time_point ReadTime;
+    //the frame was decoded.
+    std::chrono::steady_clock::time_point DecodeTime;
+    //the coordinates were stored.
+    std::chrono::steady_clock::time_point StoredTime;
+    //incremented for each pointing report stored, zero until the first report.
+    uint64_t Sequence;
+};
+
+//consistent view of the mount, published once per pointing report and on each state change.
+struct MountSnapshot
+{
+    //coordinates as reported by the mount.
+    SerialDeviceControl::EquatorialCoordinates RawCoordinates;
+    //reported coordinates with the sync correction applied.
+    SerialDeviceControl::EquatorialCoordinates Coordinates;
+    //coordinates the sync correction is relative to, NaN until a goto or a tracking report.
+    SerialDeviceControl::EquatorialCoordinates SyncBase;
+    //correction added to the reported coordinates.
+    SerialDeviceControl::EquatorialCoordinates SyncCorrection;
+    //state of the mount when the snapshot was published.
+    TelescopeMountState State;
+    //the snapshot was published.
+    std::chrono::steady_clock::time_point PublishTime;
+    //incremented for each snapshot published.
+    uint64_t Sequence;
+};
+
 //These types have to inherit/implement:
 //-The ISerialInterface.hpp as Interface type.
 template<class InterfaceType>
@@ -143,24 +187,37 @@ class ExosIIMountControl :
                     (interfaceImplementation, *this),
                     mIsMotionControlThreadRunning(false),
                     mIsMotionControlRunning(false),
-                    mMountStateMachine(*this, TelescopeMountState::Disconnected, TelescopeMountState::FailSafe)
+                    mMountStateMachine(mStateNotifier, TelescopeMountState::Disconnected, TelescopeMountState::FailSafe)
         {
+            //the transitions are logged by the notifier thread, not by the threads doing them.
+            mStateNotifier.Subscribe(*this);
+            mStateNotifier.Start();
+
             SerialDeviceControl::EquatorialCoordinates initialCoordinates;
             initialCoordinates.RightAscension = std::numeric_limits<float>::quiet_NaN();
             initialCoordinates.Declination    = std::numeric_limits<float>::quiet_NaN();
 
-            mCurrentPointingCoordinates.Set(initialCoordinates);
+            mWorkingSnapshot.RawCoordinates = initialCoordinates;
+            mWorkingSnapshot.Coordinates = initialCoordinates;
+            mWorkingSnapshot.Sequence = 0;
 
             ResetCurrentCoordinatesSyncCorrection();
 
             mSiteLocationCoordinates.Set(initialCoordinates);
 
+            PointingTiming initialTiming;
+            initialTiming.Sequence = 0;
+
+            mPointingTiming.Set(initialTiming);
+
             MotionState initialState;
             initialState.MotionDirection = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
             initialState.CommandsPerSecond = 0;
 
             mMotionState.Set(initialState);
 
+            mSkippedMotionCommands.Set(0);
+
             //initialize statemachine:
             mMountStateMachine.AddFinalState(TelescopeMountState::Disconnected);
 
@@ -253,6 +310,9 @@ class ExosIIMountControl :
         virtual ~ExosIIMountControl()
         {
             SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::Stop();
+
+            //deliver the remaining transitions while this instance is still intact.
+            mStateNotifier.Stop();
         }
 
         //open the serial connection and start the serial reporting.
@@ -260,7 +320,7 @@ class ExosIIMountControl :
         {
             mMountStateMachine.Reset();
 
-            mMountStateMachine.DoTransition(TelescopeSignals::Connect);
+            DoMountTransition(TelescopeSignals::Connect);
 
             SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::Start();
 
@@ -288,15 +348,19 @@ class ExosIIMountControl :
 
         void ResetCurrentCoordinatesSyncCorrection()
         {
+            std::lock_guard<std::mutex> guard(mSnapshotWriteMutex);
+
             SerialDeviceControl::EquatorialCoordinates initialSyncCorrCoordinates;
             initialSyncCorrCoordinates.RightAscension = 0.;
             initialSyncCorrCoordinates.Declination = 0.;
-            mCurrentPointingCoordinatesSyncCorrection.Set(initialSyncCorrCoordinates);
+            mWorkingSnapshot.SyncCorrection = initialSyncCorrCoordinates;
             
             SerialDeviceControl::EquatorialCoordinates initialSyncBaseCoordinates;
             initialSyncBaseCoordinates.RightAscension = std::numeric_limits<float>::quiet_NaN();
             initialSyncBaseCoordinates.Declination    = std::numeric_limits<float>::quiet_NaN();            
-            mCurrentPointingCoordinatesSyncBase.Set(initialSyncBaseCoordinates);
+            mWorkingSnapshot.SyncBase = initialSyncBaseCoordinates;
+
+            PublishSnapshot();
         }
 
 
@@ -320,22 +384,30 @@ class ExosIIMountControl :
 
             mMotionControlCondition.notify_all();
 
-            return mMountStateMachine.DoTransition(TelescopeSignals::StartMotion);
+            return DoMountTransition(TelescopeSignals::StartMotion);
         }
 
         bool StopMotionToDirection()
         {
             //this changes back to tracking
-            MotionState stopState;
-            stopState.MotionDirection = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-            stopState.CommandsPerSecond = 0;
+            {
+                //changed while the motion thread is not between checking and waiting, so it can not miss the notification.
+                std::lock_guard<std::mutex> notifyLock(mMotionCommandControlMutex);
 
-            mMotionState.Set(stopState);
+                MotionState stopState;
+                stopState.MotionDirection = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
+                stopState.CommandsPerSecond = 0;
 
-            mIsMotionControlRunning.Set(false);
+                mMotionState.Set(stopState);
+
+                mIsMotionControlRunning.Set(false);
+            }
 
             mMotionControlCondition.notify_all();
 
+            //motion commands still queued would keep the mount moving after it was released.
+            SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::DiscardMessageFrames(SerialDeviceControl::TransmitPriority::MotionPriority);
+
             if(mMountStateMachine.CurrentState() != TelescopeMountState::MoveWhileTracking)
             {
                 std::cerr << "motion already disabled." << std::endl;
@@ -343,64 +415,32 @@ class ExosIIMountControl :
             }
             else
             {
-                return mMountStateMachine.DoTransition(TelescopeSignals::StopMotion);
+                return DoMountTransition(TelescopeSignals::StopMotion);
             }
         }
 
         //Disconnect from the mount.
         bool DisconnectSerial()
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetDisconnectCommandMessage(messageBuffer))
-            {
-                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                              &messageBuffer[0], 0, messageBuffer.size());
+            bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(SerialDeviceControl::SerialCommand::DisconnectCommandFrame, SerialDeviceControl::TransmitPriority::StopPriority);
 
-                return rc && mMountStateMachine.DoTransition(TelescopeSignals::Disconnect);
-            }
-            else
-            {
-                std::cerr << "DisconnectSerial: Failed!" << std::endl;
-                return false;
-            }
+            return rc && DoMountTransition(TelescopeSignals::Disconnect);
         }
 
         //stop any motion of the telescope.
         bool StopMotion()
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetStopMotionCommandMessage(messageBuffer))
-            {
-                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                              &messageBuffer[0], 0, messageBuffer.size());
+            bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(SerialDeviceControl::SerialCommand::StopMotionCommandFrame, SerialDeviceControl::TransmitPriority::StopPriority);
 
-                return rc && mMountStateMachine.DoTransition(TelescopeSignals::Stop);
-            }
-            else
-            {
-                std::cerr << "StopMotion: Failed!" << std::endl;
-                return false;
-            }
+            return rc && DoMountTransition(TelescopeSignals::Stop);
         }
 
         //Order to telescope to go to the parking state.
         bool ParkPosition()
         {
+            bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(SerialDeviceControl::SerialCommand::ParkCommandFrame, SerialDeviceControl::TransmitPriority::GoToPriority);
 
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetParkCommandMessage(messageBuffer))
-            {
-                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                              &messageBuffer[0], 0, messageBuffer.size());
-
-
-                return rc && mMountStateMachine.DoTransition(TelescopeSignals::Park);
-            }
-            else
-            {
-                std::cerr << "ParkPosition: Failed!" << std::endl;
-                return false;
-            }
+            return rc && DoMountTransition(TelescopeSignals::Park);
         }
 
         //GoTo and track the sky position represented by the equatorial coordinates.
@@ -410,23 +450,29 @@ class ExosIIMountControl :
             )
         {
 
-            SerialDeviceControl::EquatorialCoordinates tmpSyncCorrCoordinates;
-            tmpSyncCorrCoordinates = mCurrentPointingCoordinatesSyncCorrection.Get();
-            rightAscension = rightAscension - tmpSyncCorrCoordinates.RightAscension;
-            declination = declination - tmpSyncCorrCoordinates.Declination;
+            {
+                std::lock_guard<std::mutex> guard(mSnapshotWriteMutex);
 
-            SerialDeviceControl::EquatorialCoordinates tmpSyncBaseCoordinates;
-            tmpSyncBaseCoordinates.RightAscension = rightAscension;
-            tmpSyncBaseCoordinates.Declination    = declination;              
-            mCurrentPointingCoordinatesSyncBase.Set(tmpSyncBaseCoordinates);            
+                SerialDeviceControl::EquatorialCoordinates tmpSyncCorrCoordinates;
+                tmpSyncCorrCoordinates = mWorkingSnapshot.SyncCorrection;
+                rightAscension = rightAscension - tmpSyncCorrCoordinates.RightAscension;
+                declination = declination - tmpSyncCorrCoordinates.Declination;
+
+                SerialDeviceControl::EquatorialCoordinates tmpSyncBaseCoordinates;
+                tmpSyncBaseCoordinates.RightAscension = rightAscension;
+                tmpSyncBaseCoordinates.Declination    = declination;
+                mWorkingSnapshot.SyncBase = tmpSyncBaseCoordinates;
+
+                //published right away, the state transition below only publishes if the state changes (e.g. not while slewing already).
+                PublishSnapshot();
+            }
 
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetGotoCommandMessage(messageBuffer, rightAscension, declination))
+            SerialDeviceControl::MessageFrame messageFrame;
+            if(SerialDeviceControl::SerialCommand::GetGotoCommandFrame(messageFrame, rightAscension, declination))
             {
-                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                              &messageBuffer[0], 0, messageBuffer.size());
+                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(messageFrame, SerialDeviceControl::TransmitPriority::GoToPriority);
 
-                return rc && mMountStateMachine.DoTransition(TelescopeSignals::GoTo);
+                return rc && DoMountTransition(TelescopeSignals::GoTo);
             }
             else
             {
@@ -442,15 +488,16 @@ class ExosIIMountControl :
             float declination
             )
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetSyncCommandMessage(messageBuffer, rightAscension, declination))
+            SerialDeviceControl::MessageFrame messageFrame;
+            if(SerialDeviceControl::SerialCommand::GetSyncCommandFrame(messageFrame, rightAscension, declination))
             {                
 
                     // Talking to coordinates correction inside driver without talking to mount
                     std::cerr << "Sent Sync command to coordinates correction!" << std::endl;   
+                    std::lock_guard<std::mutex> guard(mSnapshotWriteMutex);
                     SerialDeviceControl::EquatorialCoordinates tmpSyncBaseCoordinates;
                     SerialDeviceControl::EquatorialCoordinates tmpSyncCorrCoordinates;
-                    tmpSyncBaseCoordinates = mCurrentPointingCoordinatesSyncBase.Get();
+                    tmpSyncBaseCoordinates = mWorkingSnapshot.SyncBase;
                     if (std::isnan(tmpSyncBaseCoordinates.RightAscension)) {
                         tmpSyncCorrCoordinates.RightAscension =0. ;
                     }   
@@ -463,14 +510,15 @@ class ExosIIMountControl :
                     else {
                         tmpSyncCorrCoordinates.Declination = declination - tmpSyncBaseCoordinates.Declination;
                     }
-                    mCurrentPointingCoordinatesSyncCorrection.Set(tmpSyncCorrCoordinates);
+                    mWorkingSnapshot.SyncCorrection = tmpSyncCorrCoordinates;
+                    PublishSnapshot();
                     return true;
 
                     // // Talking to mount
                     // std::cerr << "Sent Sync command to mount!" << std::endl;       
-                    // return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                    //         &messageBuffer[0], 0, messageBuffer.size());
-                    // //return rc && mMountStateMachine.DoTransition(TelescopeSignals::GoTo);
+                    // return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(
+                    //         messageFrame, SerialDeviceControl::TransmitPriority::GoToPriority);
+                    // //return rc && DoMountTransition(TelescopeSignals::GoTo);
 
             }
             else
@@ -482,17 +530,22 @@ class ExosIIMountControl :
         }
 
         //Set the location of the telesope, using decimal latitude and longitude parameters.
+        //The location is requested back right away in the same batch, so the reported site location is up to date.
+        //The read back only updates the stored location outside of the connection sequence.
         //This does not change to state of the telescope.
         bool SetSiteLocation(
             float latitude,
             float longitude
             )
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetSetSiteLocationCommandMessage(messageBuffer, latitude, longitude))
+            SerialDeviceControl::MessageFrame messageFrame;
+            if(SerialDeviceControl::SerialCommand::GetSetSiteLocationCommandFrame(messageFrame, latitude, longitude))
             {
-                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                           &messageBuffer[0], 0, messageBuffer.size());
+                SerialDeviceControl::FrameBatch batch;
+                batch.Add(messageFrame);
+                batch.Add(SerialDeviceControl::SerialCommand::GetSiteLocationCommandFrame);
+
+                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBatch(batch, SerialDeviceControl::TransmitPriority::ConfigurationPriority);
             }
             else
             {
@@ -505,19 +558,7 @@ class ExosIIMountControl :
         //This does not change to state of the telescope.
         bool RequestSiteLocation()
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetGetSiteLocationCommandMessage(messageBuffer))
-            {
-                //std::cout << "Message sent!" << std::endl;
-                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                           &messageBuffer[0], 0, messageBuffer.size());
-            }
-            else
-            {
-                //TODO: error message
-                std::cerr << "RequestSiteLocation: Failed!" << std::endl;
-                return false;
-            }
+            return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(SerialDeviceControl::SerialCommand::GetSiteLocationCommandFrame, SerialDeviceControl::TransmitPriority::ConfigurationPriority);
         }
 
         //issue the set time command, using date and time parameters. This does not change the state of the telescope.
@@ -531,11 +572,10 @@ class ExosIIMountControl :
             int8_t utc_offset
             )
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetSetDateTimeCommandMessage(messageBuffer, year, month, day, hour, minute, second, utc_offset))
+            SerialDeviceControl::MessageFrame messageFrame;
+            if(SerialDeviceControl::SerialCommand::GetSetDateTimeCommandFrame(messageFrame, year, month, day, hour, minute, second, utc_offset))
             {
-                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                           &messageBuffer[0], 0, messageBuffer.size());
+                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(messageFrame, SerialDeviceControl::TransmitPriority::ConfigurationPriority);
             }
             else
             {
@@ -546,13 +586,13 @@ class ExosIIMountControl :
         }
 
         template<SerialDeviceControl::SerialCommandID Direction>
-        bool GuideDirection()
+        bool GuideDirection(const std::shared_ptr<SerialDeviceControl::FrameDelivery> &delivery)
         {			
-            std::vector<uint8_t> messageBuffer;
+            SerialDeviceControl::MessageFrame messageFrame;
             
-            if(SerialDeviceControl::SerialCommand::GetMoveWhileTrackingCommandMessage(messageBuffer,Direction))
+            if(SerialDeviceControl::SerialCommand::GetMoveWhileTrackingCommandFrame(messageFrame, Direction))
             {
-                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType,TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(&messageBuffer[0],0,messageBuffer.size());
+                return SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(messageFrame, SerialDeviceControl::TransmitPriority::GuidePriority, delivery);
             }
             else
             {
@@ -561,35 +601,34 @@ class ExosIIMountControl :
             }
         }
 
-        bool GuideNorth()
+        bool GuideNorth(const std::shared_ptr<SerialDeviceControl::FrameDelivery> &delivery = std::shared_ptr<SerialDeviceControl::FrameDelivery>())
         {
-            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID>();
+            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID>(delivery);
         }
 
-        bool GuideSouth()
+        bool GuideSouth(const std::shared_ptr<SerialDeviceControl::FrameDelivery> &delivery = std::shared_ptr<SerialDeviceControl::FrameDelivery>())
         {
-            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID>();
+            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID>(delivery);
         }
 
-        bool GuideEast()
+        bool GuideEast(const std::shared_ptr<SerialDeviceControl::FrameDelivery> &delivery = std::shared_ptr<SerialDeviceControl::FrameDelivery>())
         {
-            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID>();
+            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID>(delivery);
         }
 
-        bool GuideWest()
+        bool GuideWest(const std::shared_ptr<SerialDeviceControl::FrameDelivery> &delivery = std::shared_ptr<SerialDeviceControl::FrameDelivery>())
         {
-            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID>();
+            return GuideDirection<SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID>(delivery);
         }
 
         template<SerialDeviceControl::SerialCommandID Direction>
         bool MoveDirection()
         {
-            std::vector<uint8_t> messageBuffer;
-            if(SerialDeviceControl::SerialCommand::GetMoveWhileTrackingCommandMessage(messageBuffer, Direction))
+            SerialDeviceControl::MessageFrame messageFrame;
+            if(SerialDeviceControl::SerialCommand::GetMoveWhileTrackingCommandFrame(messageFrame, Direction))
             {
-                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageBuffer(
-                              &messageBuffer[0], 0, messageBuffer.size());
-                return rc && mMountStateMachine.DoTransition(TelescopeSignals::StartMotion);
+                bool rc = SerialDeviceControl::SerialCommandTransceiver<InterfaceType, TelescopeMountControl::ExosIIMountControl<InterfaceType>>::SendMessageFrame(messageFrame, SerialDeviceControl::TransmitPriority::MotionPriority);
+                return rc && DoMountTransition(TelescopeSignals::StartMotion);
             }
             else
             {
@@ -622,25 +661,34 @@ class ExosIIMountControl :
         //Called each time a pair of coordinates was received from the serial interface.
         virtual void OnPointingCoordinatesReceived(
             float right_ascension,
-            float declination
+            float declination,
+            const SerialDeviceControl::FrameTiming &timing
             )
         {
             //std::cerr << "Received data : RA: " << right_ascension << " DEC:" << declination << std::endl;
 
-            SerialDeviceControl::EquatorialCoordinates lastCoordinates = GetPointingCoordinates();
+            //the coordinates, the sync values and the resulting state are published as one snapshot.
+            std::lock_guard<std::mutex> guard(mSnapshotWriteMutex);
+
+            SerialDeviceControl::EquatorialCoordinates lastCoordinates = mWorkingSnapshot.Coordinates;
+
+            SerialDeviceControl::EquatorialCoordinates rawCoordinates;
+            rawCoordinates.RightAscension = right_ascension;
+            rawCoordinates.Declination = declination;
+            rawCoordinates.TimeStamp = timing.FirstByteReadTime;
 
             SerialDeviceControl::EquatorialCoordinates coordinatesReceived;
 
             SerialDeviceControl::EquatorialCoordinates tmpSyncCorrCoordinates;
-            tmpSyncCorrCoordinates = mCurrentPointingCoordinatesSyncCorrection.Get();
+            tmpSyncCorrCoordinates = mWorkingSnapshot.SyncCorrection;
             coordinatesReceived.RightAscension = right_ascension + tmpSyncCorrCoordinates.RightAscension;
             coordinatesReceived.Declination = declination + tmpSyncCorrCoordinates.Declination;
-
-            
+            coordinatesReceived.TimeStamp = timing.FirstByteReadTime;
 
             bool coordinatesNotNan = !std::isnan(right_ascension) && !std::isnan(declination);
 
-            mCurrentPointingCoordinates.Set(coordinatesReceived);
+            mWorkingSnapshot.RawCoordinates = rawCoordinates;
+            mWorkingSnapshot.Coordinates = coordinatesReceived;
 
             SerialDeviceControl::EquatorialCoordinates delta = SerialDeviceControl::EquatorialCoordinates::Delta(lastCoordinates,
                     coordinatesReceived);
@@ -723,7 +771,7 @@ class ExosIIMountControl :
                             SerialDeviceControl::EquatorialCoordinates tmpSyncBaseCoordinates;                            
                             tmpSyncBaseCoordinates.RightAscension = right_ascension;
                             tmpSyncBaseCoordinates.Declination = declination;
-                            mCurrentPointingCoordinatesSyncBase.Set(tmpSyncBaseCoordinates);
+                            mWorkingSnapshot.SyncBase = tmpSyncBaseCoordinates;
 
                             signal = TelescopeSignals::Track;
                         }
@@ -753,6 +801,17 @@ class ExosIIMountControl :
             {
                 mMountStateMachine.DoTransition(signal);
             }
+
+            PublishSnapshot();
+
+            PointingTiming storedTiming = mPointingTiming.Get();
+            storedTiming.ReadTime = timing.ReadTime;
+            storedTiming.DecodeTime = timing.DecodeTime;
+            storedTiming.StoredTime = mWorkingSnapshot.PublishTime;
+            storedTiming.Sequence++;
+
+            mPointingTiming.Set(storedTiming);
+            mDecodeToStoredLatency.Record(storedTiming.StoredTime - timing.DecodeTime);
         }
 
         //Called each time a pair of geo coordinates was received from 
@@ -760,7 +819,8 @@ class ExosIIMountControl :
         //(GET_SITE_LOCATION_COMMAND_ID)
         virtual void OnSiteLocationCoordinatesReceived(
             float latitude,
-            float longitude
+            float longitude,
+            const SerialDeviceControl::FrameTiming &timing
             )
         {
             std::cerr << "Received data : LAT: " << latitude << " LON:" << longitude << std::endl;
@@ -768,10 +828,17 @@ class ExosIIMountControl :
             SerialDeviceControl::EquatorialCoordinates coordinatesReceived;
             coordinatesReceived.RightAscension = latitude;
             coordinatesReceived.Declination = longitude;
+            coordinatesReceived.TimeStamp = timing.FirstByteReadTime;
 
             mSiteLocationCoordinates.Set(coordinatesReceived);
 
-            mMountStateMachine.DoTransition(TelescopeSignals::RequestedGeoLocationReceived);
+            //only the connection sequence waits for the site location, a later report
+            //(e.g. the read back after SetSiteLocation) just updates the stored location.
+            TelescopeMountState currentState = mMountStateMachine.CurrentState();
+            if(currentState == TelescopeMountState::Unknown || currentState == TelescopeMountState::Connected)
+            {
+                DoMountTransition(TelescopeSignals::RequestedGeoLocationReceived);
+            }
         }
 
         virtual void OnTransitionChanged(
@@ -803,10 +870,40 @@ class ExosIIMountControl :
             return mMountStateMachine.CurrentState();
         }
 
+        //return the last published snapshot of the mount, the coordinates and the state in it belong together.
+        MountSnapshot GetMountSnapshot()
+        {
+            return mMountSnapshots.Read();
+        }
+
         //return the current pointing coordinates.
         SerialDeviceControl::EquatorialCoordinates GetPointingCoordinates()
         {
-            return mCurrentPointingCoordinates.Get();
+            return mMountSnapshots.Read().Coordinates;
+        }
+
+        //return the timing of the current pointing coordinates.
+        PointingTiming GetPointingTiming()
+        {
+            return mPointingTiming.Get();
+        }
+
+        //return the latencies from decoding a pointing report to storing its coordinates.
+        SerialDeviceControl::LatencyHistogram &GetDecodeToStoredLatency()
+        {
+            return mDecodeToStoredLatency;
+        }
+
+        //return the lateness of the motion commands sent, relative to their deadlines.
+        SerialDeviceControl::LatencyHistogram &GetMotionCadenceJitter()
+        {
+            return mMotionCadenceJitter;
+        }
+
+        //return the number of motion commands skipped, because the motion thread was late by whole periods.
+        uint64_t GetSkippedMotionCommandCount()
+        {
+            return mSkippedMotionCommands.Get();
         }
 
         //return the current pointing coordinates.
@@ -816,18 +913,24 @@ class ExosIIMountControl :
         }
 
     private:
-        //mutex protected container for the current coordinates the telescope is pointing at.
-        SerialDeviceControl::CriticalData<SerialDeviceControl::EquatorialCoordinates> mCurrentPointingCoordinates;
+        //serializes the writers of the working snapshot, readers only use the published snapshots.
+        std::mutex mSnapshotWriteMutex;
+
+        //coordinates, sync correction and sync base as last updated, protected by the snapshot write mutex.
+        MountSnapshot mWorkingSnapshot;
 
-        // mutex protected container for correction for coordinates used by Sync function 
-        SerialDeviceControl::CriticalData<SerialDeviceControl::EquatorialCoordinates> mCurrentPointingCoordinatesSyncCorrection;
-        
-        // mutex protected container for the correction base used by Sync function
-        SerialDeviceControl::CriticalData<SerialDeviceControl::EquatorialCoordinates> mCurrentPointingCoordinatesSyncBase;        
+        //snapshots published to the readers.
+        SerialDeviceControl::SnapshotBuffer<MountSnapshot, MOUNT_SNAPSHOT_SLOT_COUNT> mMountSnapshots;
 
         //mutex protected container for the current site location set in the telescope.
         SerialDeviceControl::CriticalData<SerialDeviceControl::EquatorialCoordinates> mSiteLocationCoordinates;
 
+        //mutex protected container for the timing of the current coordinates.
+        SerialDeviceControl::CriticalData<PointingTiming> mPointingTiming;
+
+        //latencies from decoding a pointing report to storing its coordinates.
+        SerialDeviceControl::LatencyHistogram mDecodeToStoredLatency;
+
         //mutex protected container for the current telescope state.
         //SerialDeviceControl::CriticalData<TelescopeMountState> mTelescopeState;
 
@@ -840,6 +943,12 @@ class ExosIIMountControl :
         //holds the state of motion, direction and rate.
         SerialDeviceControl::CriticalData<MotionState> mMotionState;
 
+        //lateness of the motion commands sent, relative to their deadlines.
+        SerialDeviceControl::LatencyHistogram mMotionCadenceJitter;
+
+        //number of motion commands skipped, written by the motion thread only.
+        SerialDeviceControl::CriticalData<uint64_t> mSkippedMotionCommands;
+
         //motion control thread structure, to periodically sent direction commands.
         std::thread mMotionCommandThread;
 
@@ -850,14 +959,46 @@ class ExosIIMountControl :
         //Condition variable to signal start and stop of motion command sending.
         std::condition_variable mMotionControlCondition;
 
+        //queues the transitions of the state machine, and delivers them to this instance on its own thread.
+        AsyncStateNotifier<TelescopeMountState, TelescopeSignals, MOUNT_STATE_EVENT_QUEUE_SIZE> mStateNotifier;
+
         //state machine of the the telescope hardware
         MountStateMachine mMountStateMachine;
 
+        //publish a copy of the working snapshot with the current state, the snapshot write mutex has to be held.
+        void PublishSnapshot()
+        {
+            mWorkingSnapshot.State = mMountStateMachine.CurrentState();
+            mWorkingSnapshot.PublishTime = std::chrono::steady_clock::now();
+            mWorkingSnapshot.Sequence++;
+
+            mMountSnapshots.Publish(mWorkingSnapshot);
+        }
+
+        //do a transition of the state machine, and publish a snapshot if the state changed.
+        bool DoMountTransition(TelescopeSignals signal)
+        {
+            std::lock_guard<std::mutex> guard(mSnapshotWriteMutex);
+
+            TelescopeMountState fromState = mMountStateMachine.CurrentState();
+
+            bool rc = mMountStateMachine.DoTransition(signal);
+
+            if(mMountStateMachine.CurrentState() != fromState)
+            {
+                PublishSnapshot();
+            }
+
+            return rc;
+        }
+
         //Thread function for the motion thread.
+        //The commands are sent on absolute steady clock deadlines, so neither the time to send nor clock adjustments add to the period.
+        //A command late by less than a period is sent right away to catch up, whole periods missed are skipped.
+        //Stopping the motion wakes the thread immediately.
         void MotionControlThreadFunction()
         {
             bool isThreadRunning = mIsMotionControlThreadRunning.Get();
-            bool isMotionRunning;// = mIsMotionControlRunning.Get();
 
             if(!isThreadRunning)
             {
@@ -865,46 +1006,57 @@ class ExosIIMountControl :
 
                 std::cerr << "Motion Control Thread started!" << std::endl;
 
-                do
+                std::unique_lock<std::mutex> motionLock(mMotionCommandControlMutex);
+
+                while(mIsMotionControlThreadRunning.Get())
                 {
-                    do
+                    if(!mIsMotionControlRunning.Get())
                     {
-                        std::unique_lock<std::mutex> motionLock(mMotionCommandControlMutex);
-                        isMotionRunning = mIsMotionControlRunning.Get();
+                        //initially no motion commands are send, so wait until a motion in either direction is started by the start call.
+                        mMotionControlCondition.wait(motionLock);
+                        continue;
+                    }
 
-                        if(!isMotionRunning)
-                        {
-                            //initially no motion commands are send, so wait until a motion in either direction is started by the start call.
-                            mMotionControlCondition.wait(motionLock);
+                    MotionState motionState = mMotionState.Get();
 
-                            isMotionRunning = mIsMotionControlRunning.Get();
-                            if(!isMotionRunning)
-                            {
-                                break;
-                            }
-                        }
+                    //check if motion state is valid.
+                    if
+                    (
+                        motionState.MotionDirection <= SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID ||
+                        motionState.MotionDirection >= SerialDeviceControl::SerialCommandID::STOP_MOTION_COMMAND_ID ||
+                        motionState.CommandsPerSecond == 0
+                    )
+                    {
+                        //motion is tripped but no values are provided -> disable motion and wait again.
+                        mIsMotionControlRunning.Set(false);
 
-                        MotionState motionState = mMotionState.Get();
+                        motionState.MotionDirection = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
+                        motionState.CommandsPerSecond = 0;
 
-                        //check if motion state is valid.
-                        if
-                        (
-                            motionState.MotionDirection <= SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID ||
-                            motionState.MotionDirection >= SerialDeviceControl::SerialCommandID::STOP_MOTION_COMMAND_ID ||
-                            motionState.CommandsPerSecond == 0
-                        )
-                        {
-                            //motion is tripped but no values are provided -> disable motion and wait again.
-                            mIsMotionControlRunning.Set(false);
+                        mMotionState.Set(motionState);
+                        continue;
+                    }
 
-                            motionState.MotionDirection = SerialDeviceControl::SerialCommandID::NULL_COMMAND_ID;
-                            motionState.CommandsPerSecond = 0;
+                    //the period is kept in clock ticks, so the rate is not truncated to whole milliseconds.
+                    std::chrono::steady_clock::duration period =
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / motionState.CommandsPerSecond;
 
-                            mMotionState.Set(motionState);
-                            break;
-                        }
+                    //the first command of a motion is sent right away.
+                    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+                    //wake up when the motion is stopped or changed.
+                    auto isMotionChanged = [this, &motionState]()
+                    {
+                        MotionState currentState = mMotionState.Get();
+
+                        return !mIsMotionControlRunning.Get() ||
+                               currentState.MotionDirection != motionState.MotionDirection ||
+                               currentState.CommandsPerSecond != motionState.CommandsPerSecond;
+                    };
 
-                        int waitTime = 1000 / motionState.CommandsPerSecond;
+                    while(!isMotionChanged())
+                    {
+                        mMotionCadenceJitter.Record(std::chrono::steady_clock::now() - deadline);
 
                         //send command to move to direction.
                         switch(motionState.MotionDirection)
@@ -929,16 +1081,22 @@ class ExosIIMountControl :
                                 break;
                         }
 
-                        //wait before next loop.
-                        std::this_thread::sleep_until(std::chrono::system_clock::now() + std::chrono::milliseconds(waitTime));
+                        deadline += period;
 
-                        isMotionRunning = mIsMotionControlRunning.Get();
-                    }
-                    while(isMotionRunning);
+                        std::chrono::steady_clock::duration lateness = std::chrono::steady_clock::now() - deadline;
+
+                        if(lateness >= period)
+                        {
+                            //skip the commands missed, instead of sending them back to back.
+                            uint64_t missedPeriods = lateness / period;
 
-                    isThreadRunning = mIsMotionControlThreadRunning.Get();
+                            deadline += period * missedPeriods;
+                            mSkippedMotionCommands.Set(mSkippedMotionCommands.Get() + missedPeriods);
+                        }
+
+                        mMotionControlCondition.wait_until(motionLock, deadline, isMotionChanged);
+                    }
                 }
-                while(isThreadRunning);
 
                 std::cerr << "Motion Control Thread stopped!" << std::endl;
             }
@@ -0,0 +1,164 @@
+/*
+ * FrameSynchronizer.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _FRAMESYNCHRONIZER_H_INCLUDED_
+#define _FRAMESYNCHRONIZER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "config.h"
+
+#include "SerialCommand.hpp"
+
+namespace SerialDeviceControl
+{
+//Incremental framing state machine for the serial byte stream.
+//Tracks the progress through the message header, then collects the command id and the payload byte by byte.
+//Every byte is processed in constant time without rescanning, so junk on the line only costs linear time.
+//The handler type has to implement:
+//-void OnFrameStarted(), called when the first header byte of a potential frame was received.
+//-void OnFrameReceived(const uint8_t* frame), called with MESSAGE_FRAME_SIZE bytes each time a frame is complete.
+template<class FrameHandlerType>
+class FrameSynchronizer
+{
+        //A mismatch inside the header can only restart a new header with the current byte,
+        //if the first header byte does not appear again within the header.
+        static_assert(SerialCommand::MessageHeader[1] != SerialCommand::MessageHeader[0] &&
+                      SerialCommand::MessageHeader[2] != SerialCommand::MessageHeader[0] &&
+                      SerialCommand::MessageHeader[3] != SerialCommand::MessageHeader[0],
+                      "the header resynchronization requires a unique first header byte.");
+
+        static_assert(MESSAGE_HEADER_SIZE < MESSAGE_FRAME_SIZE, "the frame has to be larger than its header.");
+
+    public:
+        //Create the synchronizer, decoded frames are emitted to the handler provided.
+        FrameSynchronizer(FrameHandlerType &frameHandler) :
+            mFrameHandler(frameHandler),
+            mPosition(0),
+            mJunkByteCount(0),
+            mFrameCount(0)
+        {
+
+        }
+
+        virtual ~FrameSynchronizer()
+        {
+
+        }
+
+        //Process a single received byte.
+        void Push(uint8_t value)
+        {
+            if(mPosition < MESSAGE_HEADER_SIZE)
+            {
+                if(value == SerialCommand::MessageHeader[mPosition])
+                {
+                    if(mPosition == 0)
+                    {
+                        mFrameHandler.OnFrameStarted();
+                    }
+
+                    mFrame[mPosition++] = value;
+                    return;
+                }
+
+                //the partial header collected so far was junk.
+                if(value == SerialCommand::MessageHeader[0])
+                {
+                    Count(mJunkByteCount, mPosition);
+                    mFrameHandler.OnFrameStarted();
+                    mFrame[0] = value;
+                    mPosition = 1;
+                }
+                else
+                {
+                    Count(mJunkByteCount, mPosition + 1);
+                    mPosition = 0;
+                }
+                return;
+            }
+
+            mFrame[mPosition++] = value;
+
+            if(mPosition == MESSAGE_FRAME_SIZE)
+            {
+                mPosition = 0;
+                Count(mFrameCount, 1);
+                mFrameHandler.OnFrameReceived(mFrame);
+            }
+        }
+
+        //Process a block of received bytes.
+        void Push(const uint8_t* values, size_t count)
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                Push(values[i]);
+            }
+        }
+
+        //Drop any partially received frame, e.g. after reconnecting.
+        void Reset()
+        {
+            Count(mJunkByteCount, mPosition);
+            mPosition = 0;
+        }
+
+        //Returns the number of bytes dropped, since they were not part of a valid frame.
+        uint64_t GetJunkByteCount()
+        {
+            return mJunkByteCount.load(std::memory_order_relaxed);
+        }
+
+        //Returns the number of complete frames emitted to the handler.
+        uint64_t GetFrameCount()
+        {
+            return mFrameCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        //Reference to the handler receiving the complete frames.
+        FrameHandlerType &mFrameHandler;
+
+        //Number of bytes of the current frame collected so far.
+        size_t mPosition;
+
+        //Number of bytes dropped while searching for a header.
+        //The counters are only written by the thread pushing the bytes, but may be read by any thread.
+        std::atomic<uint64_t> mJunkByteCount;
+
+        //Number of frames completed.
+        std::atomic<uint64_t> mFrameCount;
+
+        //Storage of the frame currently collected.
+        uint8_t mFrame[MESSAGE_FRAME_SIZE];
+
+        //increment a counter, no read-modify-write instruction needed since there is a single writer.
+        static void Count(std::atomic<uint64_t> &counter, size_t amount)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+};
+}
+#endif
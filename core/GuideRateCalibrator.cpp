@@ -0,0 +1,224 @@
+/*
+ * GuideRateCalibrator.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "GuideRateCalibrator.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using TelescopeMountControl::GuideRateCalibrator;
+using TelescopeMountControl::GuideAxisCalibration;
+using TelescopeMountControl::GuidePulseCompletion;
+using TelescopeMountControl::GuideAxis;
+using SerialDeviceControl::EquatorialCoordinates;
+using SerialDeviceControl::SerialCommandID;
+
+GuideRateCalibrator::GuideRateCalibrator()
+{
+    Reset();
+}
+
+GuideRateCalibrator::~GuideRateCalibrator()
+{
+
+}
+
+void GuideRateCalibrator::Reset()
+{
+    mPositions.Clear();
+
+    for(size_t i = 0; i < GuideAxisCount; i++)
+    {
+        mIsPulsePending[i] = false;
+
+        mCalibrations[i].ArcsecondsPerFrame = 0.0;
+        mCalibrations[i].LagMilliseconds = 0.0;
+        mCalibrations[i].SampleCount = 0;
+        mCalibrations[i].LagSampleCount = 0;
+    }
+}
+
+void GuideRateCalibrator::AddPulse(const GuidePulseCompletion &completion)
+{
+    size_t axis = completion.Axis;
+
+    //the pending pulse can not be measured, if this pulse moved the axis before its end position was reported.
+    if(mIsPulsePending[axis] && completion.FramesSent > 0 && completion.FirstFrameTime < SettledTime(mPendingPulses[axis]))
+    {
+        mIsPulsePending[axis] = false;
+    }
+
+    if(completion.Aborted || completion.FramesSent == 0)
+    {
+        return;
+    }
+
+    mPendingPulses[axis] = completion;
+    mIsPulsePending[axis] = true;
+}
+
+bool GuideRateCalibrator::AddPosition(const EquatorialCoordinates &coordinates)
+{
+    if(std::isnan(coordinates.RightAscension) || std::isnan(coordinates.Declination))
+    {
+        return false;
+    }
+
+    if(mPositions.IsFull())
+    {
+        EquatorialCoordinates oldest;
+        mPositions.PopFront(oldest);
+    }
+
+    mPositions.PushBack(coordinates);
+
+    bool isMeasured = false;
+
+    for(size_t i = 0; i < GuideAxisCount; i++)
+    {
+        if(mIsPulsePending[i] && coordinates.TimeStamp >= SettledTime(mPendingPulses[i]))
+        {
+            mIsPulsePending[i] = false;
+            isMeasured |= MeasurePulse(i, coordinates);
+        }
+    }
+
+    return isMeasured;
+}
+
+GuideAxisCalibration GuideRateCalibrator::GetCalibration(GuideAxis axis)
+{
+    return mCalibrations[axis];
+}
+
+bool GuideRateCalibrator::IsCalibrated(GuideAxis axis)
+{
+    return mCalibrations[axis].SampleCount >= GUIDE_CALIBRATION_MINIMUM_SAMPLES && mCalibrations[axis].ArcsecondsPerFrame > 0.0;
+}
+
+//the engine sends one frame per GUIDE_FRAME_PERIOD of the duration returned, and carries the remainder.
+uint32_t GuideRateCalibrator::SizePulse(GuideAxis axis, uint32_t milliseconds, double guideRate)
+{
+    if(!IsCalibrated(axis) || guideRate <= 0.0)
+    {
+        return milliseconds;
+    }
+
+    double arcseconds = milliseconds / 1000.0 * guideRate * GUIDE_SIDEREAL_RATE;
+    double frames = arcseconds / mCalibrations[axis].ArcsecondsPerFrame;
+    double duration = frames * GUIDE_FRAME_PERIOD;
+    double maximumDuration = (double)milliseconds * GUIDE_CALIBRATION_MAXIMUM_SCALE;
+
+    if(duration > maximumDuration)
+    {
+        std::cerr << "SizePulse: " << duration << " ms for " << milliseconds << " ms requested, limited to " << maximumDuration
+                  << " ms (rate " << mCalibrations[axis].ArcsecondsPerFrame << " arcsec per frame)" << std::endl;
+        duration = maximumDuration;
+    }
+
+    return (uint32_t)std::lround(duration);
+}
+
+bool GuideRateCalibrator::MeasurePulse(size_t axis, const EquatorialCoordinates &endPosition)
+{
+    const GuidePulseCompletion &pulse = mPendingPulses[axis];
+
+    //the start is the last position reported before the first frame was sent.
+    bool hasStartPosition = false;
+    EquatorialCoordinates startPosition;
+
+    for(size_t i = 0; i < mPositions.Size(); i++)
+    {
+        EquatorialCoordinates position = mPositions.At(i);
+
+        if(position.TimeStamp > pulse.FirstFrameTime)
+        {
+            break;
+        }
+
+        startPosition = position;
+        hasStartPosition = true;
+    }
+
+    if(!hasStartPosition)
+    {
+        return false;
+    }
+
+    //only the frames written moved the axis, not the frames the transmit scheduler rejected or dropped.
+    double rate = Displacement(pulse, startPosition, endPosition) / pulse.FramesSent;
+
+    GuideAxisCalibration &calibration = mCalibrations[axis];
+
+    calibration.ArcsecondsPerFrame = calibration.SampleCount == 0 ? rate :
+                                     calibration.ArcsecondsPerFrame + GUIDE_CALIBRATION_GAIN * (rate - calibration.ArcsecondsPerFrame);
+    calibration.SampleCount++;
+
+    //the lag is up to the first report showing the motion.
+    for(size_t i = 0; i < mPositions.Size(); i++)
+    {
+        EquatorialCoordinates position = mPositions.At(i);
+
+        if(position.TimeStamp <= pulse.FirstFrameTime || Displacement(pulse, startPosition, position) < GUIDE_CALIBRATION_MOTION_THRESHOLD)
+        {
+            continue;
+        }
+
+        double lag = std::chrono::duration<double, std::milli>(position.TimeStamp - pulse.FirstFrameTime).count();
+
+        calibration.LagMilliseconds = calibration.LagSampleCount == 0 ? lag :
+                                      calibration.LagMilliseconds + GUIDE_CALIBRATION_GAIN * (lag - calibration.LagMilliseconds);
+        calibration.LagSampleCount++;
+        break;
+    }
+
+    return true;
+}
+
+//north and east increase declination and right ascension.
+double GuideRateCalibrator::Displacement(const GuidePulseCompletion &pulse, const EquatorialCoordinates &from,
+        const EquatorialCoordinates &to)
+{
+    double displacement;
+
+    if(pulse.Axis == GuideAxis::DeclinationAxis)
+    {
+        displacement = (to.Declination - from.Declination) * 3600.0;
+    }
+    else
+    {
+        //right ascension in hours wraps around at 24 hours, an hour is 15 degrees along the axis.
+        double delta = std::remainder((double)to.RightAscension - (double)from.RightAscension, 24.0);
+        displacement = delta * 15.0 * 3600.0;
+    }
+
+    bool isPositiveDirection = pulse.Direction == SerialCommandID::MOVE_NORTH_COMMAND_ID ||
+                               pulse.Direction == SerialCommandID::MOVE_EAST_COMMAND_ID;
+
+    return isPositiveDirection ? displacement : -displacement;
+}
+
+std::chrono::steady_clock::time_point GuideRateCalibrator::SettledTime(const GuidePulseCompletion &pulse)
+{
+    return pulse.LastFrameTime + std::chrono::milliseconds(GUIDE_FRAME_PERIOD) + std::chrono::milliseconds(GUIDE_CALIBRATION_SETTLE_TIME);
+}
@@ -0,0 +1,126 @@
+/*
+ * GuideRateCalibrator.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _GUIDERATECALIBRATOR_H_INCLUDED_
+#define _GUIDERATECALIBRATOR_H_INCLUDED_
+
+#include <cstdint>
+#include <chrono>
+#include "config.h"
+
+#include "SerialCommand.hpp"
+#include "CircularBuffer.hpp"
+#include "PulseGuideEngine.hpp"
+
+//number of position reports kept to correlate with the pulses, has to be a power of two.
+#define GUIDE_CALIBRATION_HISTORY_SIZE (64)
+
+//time in milliseconds after the motion of the last frame of a pulse, until the position reported is taken as the end of the pulse.
+#define GUIDE_CALIBRATION_SETTLE_TIME (1500)
+
+//motion along the axis in arc seconds, a report has to show to count as the reaction to a pulse.
+#define GUIDE_CALIBRATION_MOTION_THRESHOLD (0.5)
+
+//the rate and lag estimates follow new measurements with this gain.
+#define GUIDE_CALIBRATION_GAIN (0.25)
+
+//number of measurements of an axis, before its rate is used to size pulses.
+#define GUIDE_CALIBRATION_MINIMUM_SAMPLES (3)
+
+//a sized pulse is at most this multiple of the requested duration, so a bad calibration can not turn a pulse into a slew.
+#define GUIDE_CALIBRATION_MAXIMUM_SCALE (3)
+
+//apparent motion of the stars in arc seconds per second.
+#define GUIDE_SIDEREAL_RATE (15.041)
+
+namespace TelescopeMountControl
+{
+//measured reaction of an axis to the guide pulses.
+struct GuideAxisCalibration
+{
+    //motion of the axis per move frame written in arc seconds, positive if it moves in the direction of the pulse.
+    //right ascension is measured along the axis, not on the sky, so it does not depend on the declination.
+    double ArcsecondsPerFrame;
+    //time from sending the first frame of a pulse until a position report shows motion, in milliseconds.
+    double LagMilliseconds;
+    //number of pulses measured.
+    uint32_t SampleCount;
+    //number of pulses the lag was measured for.
+    uint32_t LagSampleCount;
+};
+
+//Correlates the guide pulses executed with the position reports following them,
+//to measure how far a move frame actually moves each axis, and how long it takes until the motion shows up.
+//A pulse is measured from the last report before its first frame to the first report GUIDE_CALIBRATION_SETTLE_TIME after its motion,
+//if another pulse on the same axis starts in between, the pulse is not measured.
+//Not thread safe, the pulses and positions have to be added by the same thread (e.g. the indi event loop).
+class GuideRateCalibrator
+{
+    public:
+        GuideRateCalibrator();
+
+        virtual ~GuideRateCalibrator();
+
+        //Forget all positions, pulses and measurements.
+        void Reset();
+
+        //Add a pulse completed by the guide engine, aborted pulses are not measured.
+        void AddPulse(const GuidePulseCompletion &completion);
+
+        //Add a position reported by the mount, the time stamp has to be the monotonic read time of the report.
+        //Returns true if a pulse was measured using this position.
+        bool AddPosition(const SerialDeviceControl::EquatorialCoordinates &coordinates);
+
+        //Returns the measurements of the axis.
+        GuideAxisCalibration GetCalibration(GuideAxis axis);
+
+        //Returns true if enough pulses of the axis were measured, to size pulses from its rate.
+        bool IsCalibrated(GuideAxis axis);
+
+        //Returns the pulse duration for the guide engine, which moves the axis as far as the pulse provided would at the guide rate provided
+        //(as a multiple of the sidereal rate). The duration is returned unchanged, if the axis is not calibrated.
+        //The duration is limited to GUIDE_CALIBRATION_MAXIMUM_SCALE times the duration provided.
+        uint32_t SizePulse(GuideAxis axis, uint32_t milliseconds, double guideRate);
+
+    private:
+        //positions reported, oldest first.
+        SerialDeviceControl::CircularBuffer<SerialDeviceControl::EquatorialCoordinates, GUIDE_CALIBRATION_HISTORY_SIZE> mPositions;
+
+        //last pulse of each axis, not measured yet.
+        GuidePulseCompletion mPendingPulses[GuideAxisCount];
+        bool mIsPulsePending[GuideAxisCount];
+
+        GuideAxisCalibration mCalibrations[GuideAxisCount];
+
+        //measure the pending pulse of the axis, ending at the position provided.
+        bool MeasurePulse(size_t axis, const SerialDeviceControl::EquatorialCoordinates &endPosition);
+
+        //motion from one position to the other along the axis of the pulse in arc seconds, positive in the direction of the pulse.
+        static double Displacement(const GuidePulseCompletion &pulse, const SerialDeviceControl::EquatorialCoordinates &from,
+                                   const SerialDeviceControl::EquatorialCoordinates &to);
+
+        //the time the position provided is reported, after which the motion of the pulse is over.
+        static std::chrono::steady_clock::time_point SettledTime(const GuidePulseCompletion &pulse);
+};
+}
+#endif
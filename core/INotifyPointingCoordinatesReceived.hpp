@@ -26,20 +26,34 @@
 
 #include <cstdint>
 #include <vector>
+#include <chrono>
 #include "config.h"
 
 namespace SerialDeviceControl
 {
+//Monotonic timestamps of the stages a received frame passed.
+struct FrameTiming
+{
+    //the first byte of the frame was read from the serial device.
+    std::chrono::steady_clock::time_point FirstByteReadTime;
+
+    //the bytes completing the frame were read from the serial device.
+    std::chrono::steady_clock::time_point ReadTime;
+
+    //the frame was decoded by the dispatch thread.
+    std::chrono::steady_clock::time_point DecodeTime;
+};
+
 //Simple interface for coordinate report receiving.
 class INotifyPointingCoordinatesReceived
 {
     public:
         //Called each time a pair of coordinates was received from the serial interface.
-        virtual void OnPointingCoordinatesReceived(float right_ascension, float declination) = 0;
+        virtual void OnPointingCoordinatesReceived(float right_ascension, float declination, const FrameTiming &timing) = 0;
 
         //Called each time a pair of geo coordinates was received from the serial inferface.
         //This occurs only by active request (GET_SITE_LOCATION_COMMAND_ID)
-        virtual void OnSiteLocationCoordinatesReceived(float latitude, float longitude) = 0;
+        virtual void OnSiteLocationCoordinatesReceived(float latitude, float longitude, const FrameTiming &timing) = 0;
 };
 }
 #endif
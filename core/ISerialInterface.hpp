@@ -42,15 +42,23 @@ class ISerialInterface
         //Returns true if the serial port is open and ready to receive or transmit data.
         virtual bool IsOpen() = 0;
 
+        //Returns a descriptor which becomes readable (poll/select) when received data is available, -1 if not open.
+        virtual int GetFD() = 0;
+
         //Returns the number of bytes to read available in the serial receiver queue.
         virtual size_t BytesToRead() = 0;
 
         //Reads a byte from the serial device. Can safely cast to uint8_t unless -1 is returned, corresponding to "stream end reached".
         virtual int16_t ReadByte() = 0;
 
+        //Reads up to length bytes currently available from the serial device into the buffer without blocking.
+        //returns the number of bytes read, 0 if no data is available or an error occured.
+        virtual size_t Read(uint8_t* buffer, size_t length) = 0;
+
         //writes the buffer to the serial interface.
         //this function should handle all the quirks of various serial interfaces.
-        virtual bool Write(uint8_t* buffer, size_t offset, size_t length) = 0;
+        //returns the number of bytes written, less than length if the write failed or was partial.
+        virtual size_t Write(const uint8_t* buffer, size_t offset, size_t length) = 0;
 
         //flush the buffer.
         virtual bool Flush() = 0;
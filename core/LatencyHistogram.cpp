@@ -0,0 +1,181 @@
+/*
+ * LatencyHistogram.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "LatencyHistogram.hpp"
+
+#include <sstream>
+
+using SerialDeviceControl::LatencyHistogram;
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+
+}
+
+//Reset all buckets, concurrent recordings may be partially lost.
+void LatencyHistogram::Reset()
+{
+    for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        mBuckets[i].store(0);
+    }
+
+    mCount.store(0);
+    mSum.store(0);
+    mMaximum.store(0);
+}
+
+void LatencyHistogram::Record(std::chrono::steady_clock::duration latency)
+{
+    int64_t signedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    uint64_t microseconds = signedMicroseconds > 0 ? (uint64_t)signedMicroseconds : 0;
+
+    mBuckets[BucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(microseconds, std::memory_order_relaxed);
+
+    uint64_t maximum = mMaximum.load(std::memory_order_relaxed);
+
+    while(microseconds > maximum && !mMaximum.compare_exchange_weak(maximum, microseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t LatencyHistogram::GetCount()
+{
+    return mCount.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket)
+{
+    if(bucket >= LATENCY_HISTOGRAM_BUCKETS)
+    {
+        return 0;
+    }
+
+    return mBuckets[bucket].load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket)
+{
+    if(bucket >= LATENCY_HISTOGRAM_BUCKETS - 1)
+    {
+        return UINT64_MAX;
+    }
+
+    return ((uint64_t)1) << bucket;
+}
+
+double LatencyHistogram::GetMean()
+{
+    uint64_t count = GetCount();
+
+    if(count == 0)
+    {
+        return 0.0;
+    }
+
+    return (double)mSum.load(std::memory_order_relaxed) / count;
+}
+
+uint64_t LatencyHistogram::GetMaximum()
+{
+    return mMaximum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile)
+{
+    uint64_t count = GetCount();
+
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * count + 0.5);
+    uint64_t accumulated = 0;
+
+    for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        accumulated += GetBucketCount(i);
+
+        if(accumulated >= rank && accumulated > 0)
+        {
+            return GetBucketUpperBound(i);
+        }
+    }
+
+    return GetBucketUpperBound(LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+std::string LatencyHistogram::ToString(const std::string &name)
+{
+    std::stringstream stream;
+
+    stream << name << ": count " << GetCount() << " mean " << GetMean() << " us max " << GetMaximum()
+           << " us p50 < " << GetPercentile(50) << " us p99 < " << GetPercentile(99) << " us";
+
+    for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t bucketCount = GetBucketCount(i);
+
+        if(bucketCount == 0)
+        {
+            continue;
+        }
+
+        stream << std::endl << "  < ";
+
+        if(i == LATENCY_HISTOGRAM_BUCKETS - 1)
+        {
+            stream << "inf";
+        }
+        else
+        {
+            stream << GetBucketUpperBound(i);
+        }
+
+        stream << " us: " << bucketCount;
+    }
+
+    return stream.str();
+}
+
+//bucket 0 is below 1 us, bucket i covers [2^(i-1), 2^i) us.
+size_t LatencyHistogram::BucketIndex(uint64_t microseconds)
+{
+    size_t bucket = 0;
+
+    while(microseconds > 0 && bucket < LATENCY_HISTOGRAM_BUCKETS - 1)
+    {
+        microseconds >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
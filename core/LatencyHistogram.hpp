@@ -0,0 +1,85 @@
+/*
+ * LatencyHistogram.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _LATENCYHISTOGRAM_H_INCLUDED_
+#define _LATENCYHISTOGRAM_H_INCLUDED_
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "config.h"
+
+//number of buckets, bucket 0 holds latencies below 1 us, bucket i holds [2^(i-1), 2^i) us.
+//the last bucket collects everything above 2^(LATENCY_HISTOGRAM_BUCKETS-2) us (~8.4 s).
+#define LATENCY_HISTOGRAM_BUCKETS (25)
+
+namespace SerialDeviceControl
+{
+//Fixed size histogram of latencies using power of two microsecond buckets.
+//Recording is lock free and does not allocate, so it can be used on the hot path of any thread.
+class LatencyHistogram
+{
+    public:
+        LatencyHistogram();
+
+        virtual ~LatencyHistogram();
+
+        //Reset all buckets.
+        void Reset();
+
+        //Add a latency to the histogram, negative latencies are counted as zero.
+        void Record(std::chrono::steady_clock::duration latency);
+
+        //Returns the number of latencies recorded.
+        uint64_t GetCount();
+
+        //Returns the number of latencies recorded in the bucket provided.
+        uint64_t GetBucketCount(size_t bucket);
+
+        //Returns the upper bound of the bucket provided in microseconds.
+        static uint64_t GetBucketUpperBound(size_t bucket);
+
+        //Returns the mean latency in microseconds.
+        double GetMean();
+
+        //Returns the largest latency recorded in microseconds.
+        uint64_t GetMaximum();
+
+        //Returns the upper bound in microseconds of the bucket containing the percentile (0..100) provided.
+        uint64_t GetPercentile(double percentile);
+
+        //Returns a human readable summary, listing all non empty buckets.
+        std::string ToString(const std::string &name);
+
+    private:
+        std::atomic<uint64_t> mBuckets[LATENCY_HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> mCount;
+        std::atomic<uint64_t> mSum;
+        std::atomic<uint64_t> mMaximum;
+
+        //returns the bucket of the latency in microseconds provided.
+        static size_t BucketIndex(uint64_t microseconds);
+};
+}
+#endif
@@ -0,0 +1,154 @@
+/*
+ * MpscRingBuffer.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _MPSCRINGBUFFER_H_INCLUDED_
+#define _MPSCRINGBUFFER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "config.h"
+
+#include "SpscRingBuffer.hpp"
+
+namespace SerialDeviceControl
+{
+//Bounded lock free multiple producer single consumer queue with a power of two capacity (D. Vyukov's bounded queue).
+//Every cell carries a sequence number, telling producers and the consumer whether the cell is free or filled for the current lap.
+//Producers claim a cell by a compare and swap of the tail, the consumer never blocks producers.
+//Values which do not fit are dropped and counted, so producers never block.
+template<typename T, size_t capacity>
+class MpscRingBuffer
+{
+        static_assert(capacity > 1 && (capacity & (capacity - 1)) == 0, "the capacity has to be a power of two.");
+
+        static const size_t IndexMask = capacity - 1;
+
+        struct Cell
+        {
+            std::atomic<size_t> Sequence;
+            T Value;
+        };
+
+    public:
+        MpscRingBuffer() :
+            mHead(0),
+            mTail(0),
+            mDroppedCount(0)
+        {
+            for(size_t i = 0; i < capacity; i++)
+            {
+                mCells[i].Sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        virtual ~MpscRingBuffer()
+        {
+
+        }
+
+        //maximum number of elements the queue can hold.
+        static size_t Capacity()
+        {
+            return capacity;
+        }
+
+        //Producer, any thread: append the value, returns false and counts the value as dropped if the queue is full.
+        bool Push(const T &value)
+        {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+
+            while(true)
+            {
+                Cell &cell = mCells[tail & IndexMask];
+                size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t)sequence - (intptr_t)tail;
+
+                if(difference == 0)
+                {
+                    //the cell is free for this lap, claim it.
+                    if(mTail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                    {
+                        cell.Value = value;
+                        cell.Sequence.store(tail + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(difference < 0)
+                {
+                    //the cell still holds the value of the previous lap, the queue is full.
+                    mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else
+                {
+                    //another producer claimed the cell.
+                    tail = mTail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //Consumer, a single thread: remove the front value, returns false if the queue is empty.
+        //A value which is claimed but not yet written by its producer counts as not available.
+        bool Pop(T &value)
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            Cell &cell = mCells[head & IndexMask];
+
+            if(cell.Sequence.load(std::memory_order_acquire) != head + 1)
+            {
+                return false;
+            }
+
+            value = cell.Value;
+
+            //free the cell for the next lap.
+            cell.Sequence.store(head + capacity, std::memory_order_release);
+            mHead.store(head + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        //number of values dropped since the queue was full.
+        uint64_t GetDroppedCount()
+        {
+            return mDroppedCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        //consumer position, only written by the consumer.
+        std::atomic<size_t> mHead;
+
+        uint8_t mHeadPadding[SPSC_CACHE_LINE_SIZE];
+
+        //producer position, claimed by the producers.
+        std::atomic<size_t> mTail;
+
+        uint8_t mTailPadding[SPSC_CACHE_LINE_SIZE];
+
+        std::atomic<uint64_t> mDroppedCount;
+
+        Cell mCells[capacity];
+};
+}
+#endif
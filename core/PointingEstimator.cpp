@@ -0,0 +1,209 @@
+/*
+ * PointingEstimator.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "PointingEstimator.hpp"
+
+#include <cmath>
+
+using TelescopeMountControl::PointingEstimator;
+using TelescopeMountControl::PointingEstimate;
+using SerialDeviceControl::EquatorialCoordinates;
+
+//arc seconds per hour of right ascension along the axis.
+#define ARCSECONDS_PER_HOUR (54000.0)
+
+//arc seconds per degree of declination.
+#define ARCSECONDS_PER_DEGREE (3600.0)
+
+//arc seconds of a full turn of the right ascension axis.
+#define RIGHT_ASCENSION_PERIOD (24.0 * ARCSECONDS_PER_HOUR)
+
+//the declination does not go beyond the poles.
+#define DECLINATION_LIMIT (90.0 * ARCSECONDS_PER_DEGREE)
+
+PointingEstimator::PointingEstimator()
+{
+    Reset();
+}
+
+PointingEstimator::~PointingEstimator()
+{
+
+}
+
+void PointingEstimator::Reset()
+{
+    RestartAxis(mRightAscension, 0.0, 0.0);
+    RestartAxis(mDeclination, 0.0, 0.0);
+
+    mIsValid = false;
+    mIsRestarted = false;
+    mLastReportTime = std::chrono::steady_clock::time_point();
+}
+
+void PointingEstimator::AddReport(const EquatorialCoordinates &coordinates)
+{
+    if(std::isnan(coordinates.RightAscension) || std::isnan(coordinates.Declination))
+    {
+        return;
+    }
+
+    double rightAscension = Wrap(coordinates.RightAscension * ARCSECONDS_PER_HOUR, RIGHT_ASCENSION_PERIOD);
+    double declination = coordinates.Declination * ARCSECONDS_PER_DEGREE;
+
+    if(!mIsValid)
+    {
+        RestartAxis(mRightAscension, rightAscension, 0.0);
+        RestartAxis(mDeclination, declination, 0.0);
+
+        mIsValid = true;
+        mIsRestarted = true;
+        mLastReportTime = coordinates.TimeStamp;
+        return;
+    }
+
+    if(coordinates.TimeStamp <= mLastReportTime)
+    {
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(coordinates.TimeStamp - mLastReportTime).count();
+    mLastReportTime = coordinates.TimeStamp;
+
+    //residuals of the report against the positions predicted for its read time.
+    double rightAscensionResidual = Difference(rightAscension, mRightAscension.Position + mRightAscension.Rate * seconds, RIGHT_ASCENSION_PERIOD);
+    double declinationResidual = declination - (mDeclination.Position + mDeclination.Rate * seconds);
+
+    bool isJump = std::fabs(rightAscensionResidual) > POINTING_ESTIMATOR_RESTART_RESIDUAL ||
+                  std::fabs(declinationResidual) > POINTING_ESTIMATOR_RESTART_RESIDUAL;
+
+    if(seconds * 1000.0 > POINTING_ESTIMATOR_MAXIMUM_GAP)
+    {
+        RestartAxis(mRightAscension, rightAscension, 0.0);
+        RestartAxis(mDeclination, declination, 0.0);
+        mIsRestarted = true;
+    }
+    else if(isJump)
+    {
+        //a single jump is taken as a sync or a stop, two jumps in a row as motion, e.g. the start of a slew.
+        double rightAscensionRate = 0.0;
+        double declinationRate = 0.0;
+
+        if(mIsRestarted)
+        {
+            rightAscensionRate = Difference(rightAscension, mRightAscension.LastReported, RIGHT_ASCENSION_PERIOD) / seconds;
+            declinationRate = (declination - mDeclination.LastReported) / seconds;
+        }
+
+        RestartAxis(mRightAscension, rightAscension, rightAscensionRate);
+        RestartAxis(mDeclination, declination, declinationRate);
+
+        //the rates are unknown until the next report, the jump is taken as their uncertainty.
+        mRightAscension.RateVariance = (rightAscensionResidual / seconds) * (rightAscensionResidual / seconds);
+        mDeclination.RateVariance = (declinationResidual / seconds) * (declinationResidual / seconds);
+
+        mIsRestarted = true;
+    }
+    else
+    {
+        CorrectAxis(mRightAscension, rightAscension, rightAscensionResidual, seconds);
+        CorrectAxis(mDeclination, declination, declinationResidual, seconds);
+
+        mRightAscension.Position = Wrap(mRightAscension.Position, RIGHT_ASCENSION_PERIOD);
+        mIsRestarted = false;
+    }
+}
+
+PointingEstimate PointingEstimator::Predict(std::chrono::steady_clock::time_point time)
+{
+    PointingEstimate estimate;
+    estimate.Coordinates.TimeStamp = time;
+    estimate.IsValid = mIsValid;
+
+    double age = mIsValid ? std::chrono::duration<double, std::milli>(time - mLastReportTime).count() : 0.0;
+    estimate.AgeMilliseconds = age;
+
+    //the time between the report and the prediction, the axes are not extrapolated backwards or indefinitely.
+    double seconds = std::fmin(std::fmax(age, 0.0), (double)POINTING_ESTIMATOR_MAXIMUM_PREDICTION) / 1000.0;
+
+    double rightAscension = Wrap(mRightAscension.Position + mRightAscension.Rate * seconds, RIGHT_ASCENSION_PERIOD);
+    //a slew toward a pole stops there, the declination is not extrapolated past it.
+    double declination = std::fmin(std::fmax(mDeclination.Position + mDeclination.Rate * seconds, -DECLINATION_LIMIT), DECLINATION_LIMIT);
+
+    estimate.Coordinates.RightAscension = (float)(rightAscension / ARCSECONDS_PER_HOUR);
+    estimate.Coordinates.Declination = (float)(declination / ARCSECONDS_PER_DEGREE);
+
+    estimate.RightAscensionRate = mRightAscension.Rate;
+    estimate.DeclinationRate = mDeclination.Rate;
+
+    //the uncertainty of the position grows with the uncertainty of the rate, the longer it is extrapolated.
+    estimate.RightAscensionUncertainty = std::sqrt(mRightAscension.ResidualVariance + mRightAscension.RateVariance * seconds * seconds);
+    estimate.DeclinationUncertainty = std::sqrt(mDeclination.ResidualVariance + mDeclination.RateVariance * seconds * seconds);
+
+    return estimate;
+}
+
+void PointingEstimator::RestartAxis(AxisEstimate &axis, double reported, double rate)
+{
+    axis.Position = reported;
+    axis.Rate = rate;
+    axis.LastReported = reported;
+    axis.ResidualVariance = 0.0;
+    axis.RateVariance = 0.0;
+}
+
+void PointingEstimator::CorrectAxis(AxisEstimate &axis, double reported, double residual, double seconds)
+{
+    double rateCorrection = POINTING_ESTIMATOR_BETA * residual / seconds;
+
+    axis.Position = axis.Position + axis.Rate * seconds + POINTING_ESTIMATOR_ALPHA * residual;
+    axis.Rate = axis.Rate + rateCorrection;
+    axis.LastReported = reported;
+
+    axis.ResidualVariance += POINTING_ESTIMATOR_VARIANCE_GAIN * (residual * residual - axis.ResidualVariance);
+    axis.RateVariance += POINTING_ESTIMATOR_VARIANCE_GAIN * (rateCorrection * rateCorrection - axis.RateVariance);
+}
+
+double PointingEstimator::Difference(double to, double from, double period)
+{
+    double difference = to - from;
+
+    if(period > 0.0)
+    {
+        difference = std::remainder(difference, period);
+    }
+
+    return difference;
+}
+
+double PointingEstimator::Wrap(double position, double period)
+{
+    if(period <= 0.0)
+    {
+        return position;
+    }
+
+    double wrapped = std::fmod(position, period);
+
+    return wrapped < 0.0 ? wrapped + period : wrapped;
+}
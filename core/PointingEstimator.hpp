@@ -0,0 +1,126 @@
+/*
+ * PointingEstimator.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _POINTINGESTIMATOR_H_INCLUDED_
+#define _POINTINGESTIMATOR_H_INCLUDED_
+
+#include <cstdint>
+#include <chrono>
+#include "config.h"
+
+#include "SerialCommand.hpp"
+
+//weight of the residual of a report corrected into the position estimate.
+#define POINTING_ESTIMATOR_ALPHA (0.8)
+
+//weight of the residual of a report corrected into the rate estimate.
+#define POINTING_ESTIMATOR_BETA (0.5)
+
+//residual in arc seconds, beyond which the axes are restarted from the report, e.g. when a slew starts or the mount is synced.
+#define POINTING_ESTIMATOR_RESTART_RESIDUAL (1800.0)
+
+//time in milliseconds between two reports, beyond which the axes are restarted from the report.
+#define POINTING_ESTIMATOR_MAXIMUM_GAP (5000)
+
+//time in milliseconds after the last report, beyond which the position is not extrapolated any further.
+#define POINTING_ESTIMATOR_MAXIMUM_PREDICTION (2000)
+
+//the residual and rate variances follow new reports with this gain.
+#define POINTING_ESTIMATOR_VARIANCE_GAIN (0.5)
+
+namespace TelescopeMountControl
+{
+//position of the mount predicted for a point in time.
+struct PointingEstimate
+{
+    //predicted coordinates in decimal hours and degrees, the time stamp is the time predicted for.
+    SerialDeviceControl::EquatorialCoordinates Coordinates;
+    //standard deviation of the prediction in arc seconds, right ascension is measured along the axis.
+    double RightAscensionUncertainty;
+    double DeclinationUncertainty;
+    //estimated rates in arc seconds per second, right ascension is measured along the axis.
+    double RightAscensionRate;
+    double DeclinationRate;
+    //time from the last report to the time predicted in milliseconds.
+    double AgeMilliseconds;
+    //false until the first report was added.
+    bool IsValid;
+};
+
+//Estimates the position and rate of both axes from the position reports (about one per second),
+//using an alpha-beta filter on each axis driven by the read time stamps of the reports,
+//to predict the position between the reports, e.g. while slewing.
+//Not thread safe, the reports have to be added by the thread predicting (e.g. the indi event loop).
+class PointingEstimator
+{
+    public:
+        PointingEstimator();
+
+        virtual ~PointingEstimator();
+
+        //Forget all reports and estimates.
+        void Reset();
+
+        //Add a position reported by the mount, the time stamp has to be the monotonic read time of the report.
+        //Reports with NaN coordinates, or not newer than the last report are ignored.
+        void AddReport(const SerialDeviceControl::EquatorialCoordinates &coordinates);
+
+        //Returns the position predicted for the time provided, extrapolated at most POINTING_ESTIMATOR_MAXIMUM_PREDICTION after the last report.
+        PointingEstimate Predict(std::chrono::steady_clock::time_point time);
+
+    private:
+        //estimate of a single axis, in arc seconds.
+        struct AxisEstimate
+        {
+            double Position;
+            double Rate;
+            double LastReported;
+            double ResidualVariance;
+            double RateVariance;
+        };
+
+        //right ascension is estimated along the axis, wrapping around after 24 hours.
+        AxisEstimate mRightAscension;
+        AxisEstimate mDeclination;
+
+        bool mIsValid;
+
+        //true if the last report restarted the axes.
+        bool mIsRestarted;
+
+        std::chrono::steady_clock::time_point mLastReportTime;
+
+        //restart the axis from the position reported, with the rate provided.
+        static void RestartAxis(AxisEstimate &axis, double reported, double rate);
+
+        //correct the axis with the residual of the position reported.
+        static void CorrectAxis(AxisEstimate &axis, double reported, double residual, double seconds);
+
+        //difference of the positions in arc seconds, wrapped to the shortest way around the period provided (0 if the axis does not wrap).
+        static double Difference(double to, double from, double period);
+
+        //position wrapped into the period provided (0 if the axis does not wrap).
+        static double Wrap(double position, double period);
+};
+}
+#endif
@@ -0,0 +1,610 @@
+/*
+ * PulseGuideEngine.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _PULSEGUIDEENGINE_H_INCLUDED_
+#define _PULSEGUIDEENGINE_H_INCLUDED_
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <poll.h>
+#include <unistd.h>
+#include "config.h"
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "SerialCommand.hpp"
+#include "EventNotifier.hpp"
+#include "MpscRingBuffer.hpp"
+#include "TransmitScheduler.hpp"
+
+//guide motion done by a single move frame in milliseconds, the frames of a pulse are sent at this interval.
+//While both axes are guided, the frames of each axis are sent at twice this interval, so the line is not loaded beyond one frame per period.
+#define GUIDE_FRAME_PERIOD (20)
+
+//time in milliseconds after the last frame of a pulse was queued, until the pulse completes, even if not all its frames left the transmit queue.
+#define GUIDE_DELIVERY_TIMEOUT (1000)
+
+//number of completed pulses queued until the owner collects them, has to be a power of two.
+#define GUIDE_COMPLETION_QUEUE_SIZE (8)
+
+namespace TelescopeMountControl
+{
+//axes guided independently, a pulse on one axis replaces the pulse in progress on the same axis.
+enum GuideAxis
+{
+    //north and south pulses.
+    DeclinationAxis = 0,
+    //east and west pulses.
+    RightAscensionAxis = 1,
+    GuideAxisCount = 2
+};
+
+//a pulse finished, reported to the owner on its own thread.
+struct GuidePulseCompletion
+{
+    GuideAxis Axis;
+    SerialDeviceControl::SerialCommandID Direction;
+    //duration of the pulse requested.
+    uint32_t RequestedMilliseconds;
+    //guide motion actually done, the move frames sent times the frame period.
+    uint32_t ExecutedMilliseconds;
+    //move frames of the pulse written to the serial interface.
+    uint32_t FramesSent;
+    //move frames of the pulse not written: rejected by the full transmit queue, dropped by a stop or failed to write.
+    //for aborted pulses, this includes the frames still queued, which may be written afterwards.
+    uint32_t FramesDropped;
+    //the first and the last move frame were handed to the transmit scheduler, only valid if frames were queued.
+    std::chrono::steady_clock::time_point FirstFrameTime;
+    std::chrono::steady_clock::time_point LastFrameTime;
+    //true if the pulse was cancelled before all its frames were sent.
+    bool Aborted;
+};
+
+//Executes guide pulses as a series of move frames on its own thread, instead of chaining timers on the indi event loop.
+//The frames are sent on absolute deadlines of a timerfd, pulses on both axes run at the same time with their frames interleaved.
+//Pulse durations are not a multiple of the frame period, the remainder is carried to the next pulse on the same axis,
+//a remainder in the opposite direction cancels out.
+//A pulse completes once all its frames left the transmit queue, and reports the frames actually written to the serial interface.
+//Completed pulses are queued, and the completion descriptor becomes readable, so the owner can collect them in its event loop.
+//These types have to implement:
+//-GuideNorth(delivery), GuideSouth(delivery), GuideEast(delivery) and GuideWest(delivery) as MountType, each queueing one move frame
+// counted by the SerialDeviceControl::FrameDelivery provided, and returning false if the frame was not queued.
+template<class MountType>
+class PulseGuideEngine
+{
+        //pulse requested by the owner, not picked up by the engine thread yet.
+        struct PulseRequest
+        {
+            bool IsPending;
+            SerialDeviceControl::SerialCommandID Direction;
+            uint32_t RequestedMilliseconds;
+            uint32_t FrameCount;
+        };
+
+        //pulse executed by the engine thread.
+        struct AxisState
+        {
+            bool IsActive;
+            SerialDeviceControl::SerialCommandID Direction;
+            uint32_t RequestedMilliseconds;
+            uint32_t FrameCount;
+            //frames handed to the mount, and the part of them it queued.
+            uint32_t FramesIssued;
+            uint32_t FramesQueued;
+            //counts the frames of the pulse leaving the transmit queue.
+            std::shared_ptr<SerialDeviceControl::FrameDelivery> Delivery;
+            std::chrono::steady_clock::time_point NextDeadline;
+            std::chrono::steady_clock::time_point FirstFrameTime;
+            std::chrono::steady_clock::time_point LastFrameTime;
+        };
+
+    public:
+        PulseGuideEngine(MountType &mount) :
+            mMount(mount),
+            mThreadRunning(false),
+            mAbortRequested(false),
+            mTimerFD(-1)
+        {
+            for(size_t i = 0; i < GuideAxisCount; i++)
+            {
+                mRequests[i].IsPending = false;
+                mCarriedMilliseconds[i] = 0;
+                mAxes[i].IsActive = false;
+            }
+        }
+
+        virtual ~PulseGuideEngine()
+        {
+            Stop();
+        }
+
+        //start the engine thread.
+        bool Start()
+        {
+            if(mThreadRunning.load())
+            {
+                return true;
+            }
+
+#ifdef __linux__
+            mTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+            if(mTimerFD < 0)
+            {
+                std::cerr << "PulseGuideEngine: failed to create the timer: " << strerror(errno) << std::endl;
+                return false;
+            }
+#endif
+            mStopEvent.Clear();
+            mThreadRunning.store(true);
+            mEngineThread = std::thread(&PulseGuideEngine<MountType>::EngineThreadFunction, this);
+
+            return true;
+        }
+
+        //cancel the pulses in progress and stop the engine thread.
+        void Stop()
+        {
+            if(!mThreadRunning.load())
+            {
+                return;
+            }
+
+            mThreadRunning.store(false);
+            mStopEvent.Signal();
+            mEngineThread.join();
+
+            if(mTimerFD >= 0)
+            {
+                close(mTimerFD);
+                mTimerFD = -1;
+            }
+        }
+
+        //Request a pulse in the direction (one of the move command ids), it replaces the pulse in progress on the same axis,
+        //which is reported as aborted with the frames it sent so far.
+        //Returns the number of frames sent for this pulse, zero if it is shorter than a frame. Such a pulse is only carried
+        //to the next pulse of the axis, the pulse in progress is left running and no completion is reported for it.
+        uint32_t Pulse(SerialDeviceControl::SerialCommandID direction, uint32_t milliseconds)
+        {
+            GuideAxis axis;
+            int32_t sign;
+
+            switch(direction)
+            {
+                case SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID:
+                    axis = GuideAxis::DeclinationAxis;
+                    sign = 1;
+                    break;
+
+                case SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID:
+                    axis = GuideAxis::DeclinationAxis;
+                    sign = -1;
+                    break;
+
+                case SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID:
+                    axis = GuideAxis::RightAscensionAxis;
+                    sign = 1;
+                    break;
+
+                case SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID:
+                    axis = GuideAxis::RightAscensionAxis;
+                    sign = -1;
+                    break;
+
+                default:
+                    return 0;
+            }
+
+            uint32_t frameCount = 0;
+
+            {
+                std::lock_guard<std::mutex> guard(mRequestMutex);
+
+                //the carry is signed, positive in north/west direction.
+                int64_t owedMilliseconds = mCarriedMilliseconds[axis] + sign * (int64_t)milliseconds;
+                int64_t owedInDirection = sign * owedMilliseconds;
+
+                if(owedInDirection > 0)
+                {
+                    frameCount = (uint32_t)(owedInDirection / GUIDE_FRAME_PERIOD);
+                }
+
+                mCarriedMilliseconds[axis] = owedMilliseconds - sign * (int64_t)frameCount * GUIDE_FRAME_PERIOD;
+
+                if(frameCount == 0)
+                {
+                    return 0;
+                }
+
+                mRequests[axis].IsPending = true;
+                mRequests[axis].Direction = direction;
+                mRequests[axis].RequestedMilliseconds = milliseconds;
+                mRequests[axis].FrameCount = frameCount;
+            }
+
+            mCommandEvent.Signal();
+
+            return frameCount;
+        }
+
+        //Cancel the pulses of both axes immediately, no further frames are sent and the remainders are dropped.
+        //The cancelled pulses are reported as aborted.
+        void Abort()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mRequestMutex);
+
+                for(size_t i = 0; i < GuideAxisCount; i++)
+                {
+                    mRequests[i].IsPending = false;
+                    mCarriedMilliseconds[i] = 0;
+                }
+
+                mAbortRequested = true;
+            }
+
+            mCommandEvent.Signal();
+        }
+
+        //descriptor becoming readable when completed pulses are queued.
+        int GetCompletionFD()
+        {
+            return mCompletionEvent.GetFD();
+        }
+
+        //Owner: take the next completed pulse, returns false if there is none.
+        //The completion descriptor is reset first, so a pulse completed meanwhile signals it again.
+        bool PopCompletion(GuidePulseCompletion &completion)
+        {
+            mCompletionEvent.Clear();
+
+            return mCompletions.Pop(completion);
+        }
+
+        //Returns the number of completions dropped, because the owner did not collect them.
+        uint64_t GetDroppedCompletionCount()
+        {
+            return mCompletions.GetDroppedCount();
+        }
+
+    private:
+        MountType &mMount;
+
+        std::thread mEngineThread;
+
+        std::atomic<bool> mThreadRunning;
+
+        //protects the requests, the remainders and the abort flag.
+        std::mutex mRequestMutex;
+
+        PulseRequest mRequests[GuideAxisCount];
+
+        //remainder of the pulses not sent as a frame yet, in milliseconds, positive in north/west direction.
+        int64_t mCarriedMilliseconds[GuideAxisCount];
+
+        bool mAbortRequested;
+
+        //state of the pulses, only used by the engine thread.
+        AxisState mAxes[GuideAxisCount];
+
+        //expires at the next frame deadline, on linux.
+        int mTimerFD;
+
+        //signaled when pulses are requested or aborted.
+        SerialDeviceControl::EventNotifier mCommandEvent;
+
+        //signaled to stop the engine thread.
+        SerialDeviceControl::EventNotifier mStopEvent;
+
+        //signaled when pulses completed.
+        SerialDeviceControl::EventNotifier mCompletionEvent;
+
+        //completed pulses, produced by the engine thread only.
+        SerialDeviceControl::MpscRingBuffer<GuidePulseCompletion, GUIDE_COMPLETION_QUEUE_SIZE> mCompletions;
+
+        //queue the completion of the pulse on the axis, and make it inactive.
+        void Complete(size_t axis, bool aborted)
+        {
+            uint32_t framesWritten = mAxes[axis].Delivery->Written.load(std::memory_order_relaxed);
+
+            GuidePulseCompletion completion;
+            completion.Axis = (GuideAxis)axis;
+            completion.Direction = mAxes[axis].Direction;
+            completion.RequestedMilliseconds = mAxes[axis].RequestedMilliseconds;
+            completion.ExecutedMilliseconds = framesWritten * GUIDE_FRAME_PERIOD;
+            completion.FramesSent = framesWritten;
+            completion.FramesDropped = mAxes[axis].FramesIssued - framesWritten;
+            completion.FirstFrameTime = mAxes[axis].FirstFrameTime;
+            completion.LastFrameTime = mAxes[axis].LastFrameTime;
+            completion.Aborted = aborted;
+
+            mAxes[axis].IsActive = false;
+            mAxes[axis].Delivery.reset();
+
+            mCompletions.Push(completion);
+            mCompletionEvent.Signal();
+        }
+
+        //take over the requests of the owner.
+        void ApplyRequests()
+        {
+            std::lock_guard<std::mutex> guard(mRequestMutex);
+
+            if(mAbortRequested)
+            {
+                mAbortRequested = false;
+
+                for(size_t i = 0; i < GuideAxisCount; i++)
+                {
+                    if(mAxes[i].IsActive)
+                    {
+                        Complete(i, true);
+                    }
+                }
+            }
+
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::duration period = std::chrono::milliseconds(GUIDE_FRAME_PERIOD);
+
+            for(size_t i = 0; i < GuideAxisCount; i++)
+            {
+                if(!mRequests[i].IsPending)
+                {
+                    continue;
+                }
+
+                mRequests[i].IsPending = false;
+
+                AxisState &axis = mAxes[i];
+                AxisState &otherAxis = mAxes[(i + 1) % GuideAxisCount];
+
+                //the pulse replaced is reported with the frames it got out so far.
+                if(axis.IsActive)
+                {
+                    Complete(i, true);
+                }
+
+                axis.IsActive = true;
+                axis.Direction = mRequests[i].Direction;
+                axis.RequestedMilliseconds = mRequests[i].RequestedMilliseconds;
+                axis.FrameCount = mRequests[i].FrameCount;
+                axis.FramesIssued = 0;
+                axis.FramesQueued = 0;
+                axis.Delivery = std::make_shared<SerialDeviceControl::FrameDelivery>();
+                axis.NextDeadline = now;
+
+                if(IsSending(otherAxis))
+                {
+                    //both axes send at twice the frame period, place the frames half way between the frames of the other axis.
+                    axis.NextDeadline = std::max(otherAxis.NextDeadline + period, now);
+                }
+            }
+        }
+
+        //returns true if the axis has frames of its pulse left to hand to the mount.
+        static bool IsSending(const AxisState &axis)
+        {
+            return axis.IsActive && axis.FramesIssued < axis.FrameCount;
+        }
+
+        //send the frames due, and complete the pulses whose frames all left the transmit queue after their last frame period.
+        void ExecuteDueFrames()
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::duration period = std::chrono::milliseconds(GUIDE_FRAME_PERIOD);
+
+            for(size_t i = 0; i < GuideAxisCount; i++)
+            {
+                AxisState &axis = mAxes[i];
+
+                if(!axis.IsActive || axis.NextDeadline > now)
+                {
+                    continue;
+                }
+
+                if(axis.FramesIssued >= axis.FrameCount)
+                {
+                    bool isDelivered = axis.Delivery->Resolved.load(std::memory_order_acquire) >= axis.FramesQueued;
+                    bool isTimedOut = axis.FramesQueued > 0 && now - axis.LastFrameTime >= std::chrono::milliseconds(GUIDE_DELIVERY_TIMEOUT);
+
+                    if(isDelivered || isTimedOut)
+                    {
+                        Complete(i, false);
+                    }
+                    else
+                    {
+                        //check again after another period, the frames are still waiting to be written.
+                        axis.NextDeadline += period;
+                    }
+
+                    continue;
+                }
+
+                bool isQueued = false;
+
+                switch(axis.Direction)
+                {
+                    case SerialDeviceControl::SerialCommandID::MOVE_NORTH_COMMAND_ID:
+                        isQueued = mMount.GuideNorth(axis.Delivery);
+                        break;
+
+                    case SerialDeviceControl::SerialCommandID::MOVE_SOUTH_COMMAND_ID:
+                        isQueued = mMount.GuideSouth(axis.Delivery);
+                        break;
+
+                    case SerialDeviceControl::SerialCommandID::MOVE_WEST_COMMAND_ID:
+                        isQueued = mMount.GuideWest(axis.Delivery);
+                        break;
+
+                    case SerialDeviceControl::SerialCommandID::MOVE_EAST_COMMAND_ID:
+                        isQueued = mMount.GuideEast(axis.Delivery);
+                        break;
+
+                    default:
+                        break;
+                }
+
+                if(isQueued)
+                {
+                    if(axis.FramesQueued == 0)
+                    {
+                        axis.FirstFrameTime = now;
+                    }
+
+                    axis.LastFrameTime = now;
+                    axis.FramesQueued++;
+                }
+
+                axis.FramesIssued++;
+
+                //while the other axis sends as well, the frames of both axes alternate at the frame period.
+                axis.NextDeadline += IsSending(mAxes[(i + 1) % GuideAxisCount]) ? 2 * period : period;
+            }
+        }
+
+        //Arm the timer for the next deadline of the active pulses.
+        //Returns the timeout for poll, which is only used if there is no timerfd.
+        int ArmTimer()
+        {
+            bool isAnyActive = false;
+            std::chrono::steady_clock::time_point deadline;
+
+            for(size_t i = 0; i < GuideAxisCount; i++)
+            {
+                if(mAxes[i].IsActive && (!isAnyActive || mAxes[i].NextDeadline < deadline))
+                {
+                    deadline = mAxes[i].NextDeadline;
+                    isAnyActive = true;
+                }
+            }
+
+#ifdef __linux__
+            struct itimerspec timerValue;
+            memset(&timerValue, 0, sizeof(timerValue));
+
+            if(isAnyActive)
+            {
+                //the steady clock is CLOCK_MONOTONIC, a deadline in the past expires right away.
+                std::chrono::nanoseconds sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch());
+
+                timerValue.it_value.tv_sec = sinceEpoch.count() / 1000000000;
+                timerValue.it_value.tv_nsec = sinceEpoch.count() % 1000000000;
+
+                if(timerValue.it_value.tv_sec == 0 && timerValue.it_value.tv_nsec == 0)
+                {
+                    timerValue.it_value.tv_nsec = 1;
+                }
+            }
+
+            //a zero value disarms the timer.
+            timerfd_settime(mTimerFD, TFD_TIMER_ABSTIME, &timerValue, nullptr);
+
+            return -1;
+#else
+            if(!isAnyActive)
+            {
+                return -1;
+            }
+
+            std::chrono::steady_clock::duration remaining = deadline - std::chrono::steady_clock::now();
+
+            if(remaining <= std::chrono::steady_clock::duration::zero())
+            {
+                return 0;
+            }
+
+            //round up, so the deadline has passed on wake up.
+            return (int)std::chrono::duration_cast<std::chrono::milliseconds>(remaining + std::chrono::milliseconds(1) -
+                    std::chrono::nanoseconds(1)).count();
+#endif
+        }
+
+        //Loop of the engine thread.
+        void EngineThreadFunction()
+        {
+            std::cerr << "Pulse Guide Engine Thread started!" << std::endl;
+
+            while(mThreadRunning.load())
+            {
+                int timeout = ArmTimer();
+
+                struct pollfd descriptors[3];
+                nfds_t descriptorCount = 2;
+
+                descriptors[0].fd = mCommandEvent.GetFD();
+                descriptors[0].events = POLLIN;
+                descriptors[0].revents = 0;
+
+                descriptors[1].fd = mStopEvent.GetFD();
+                descriptors[1].events = POLLIN;
+                descriptors[1].revents = 0;
+
+                if(mTimerFD >= 0)
+                {
+                    descriptors[2].fd = mTimerFD;
+                    descriptors[2].events = POLLIN;
+                    descriptors[2].revents = 0;
+                    descriptorCount = 3;
+                }
+
+                poll(descriptors, descriptorCount, timeout);
+
+                if(descriptorCount > 2 && (descriptors[2].revents & POLLIN) != 0)
+                {
+                    uint64_t expirations;
+                    ssize_t bytesRead = read(mTimerFD, &expirations, sizeof(expirations));
+                    (void)bytesRead;
+                }
+
+                if((descriptors[0].revents & POLLIN) != 0)
+                {
+                    mCommandEvent.Clear();
+                    ApplyRequests();
+                }
+
+                ExecuteDueFrames();
+            }
+
+            //the pulses in progress are cancelled with the engine.
+            for(size_t i = 0; i < GuideAxisCount; i++)
+            {
+                if(mAxes[i].IsActive)
+                {
+                    Complete(i, true);
+                }
+            }
+
+            std::cerr << "Pulse Guide Engine Thread stopped!" << std::endl;
+        }
+};
+}
+#endif
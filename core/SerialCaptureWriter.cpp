@@ -0,0 +1,141 @@
+/*
+ * SerialCaptureWriter.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SerialCaptureWriter.hpp"
+
+#include <iostream>
+
+using SerialDeviceControl::SerialCaptureWriter;
+using SerialDeviceControl::SerialCaptureDirection;
+
+SerialCaptureWriter::SerialCaptureWriter() :
+    mFile(nullptr),
+    mCapturing(false),
+    mCapturedByteCount(0)
+{
+
+}
+
+SerialCaptureWriter::~SerialCaptureWriter()
+{
+    Stop();
+}
+
+bool SerialCaptureWriter::Start(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    if(mFile != nullptr)
+    {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+
+    mFile = fopen(path.c_str(), "ab");
+
+    if(mFile == nullptr)
+    {
+        std::cerr << "unable to open capture file " << path << "!" << std::endl;
+        mCapturing.store(false);
+        return false;
+    }
+
+    //a new file gets the header, an existing capture is continued.
+    fseek(mFile, 0, SEEK_END);
+
+    if(ftell(mFile) == 0)
+    {
+        fwrite(SERIAL_CAPTURE_MAGIC, 1, SERIAL_CAPTURE_MAGIC_SIZE, mFile);
+    }
+
+    mCapturedByteCount.store(0);
+    mCapturing.store(true);
+
+    return true;
+}
+
+void SerialCaptureWriter::Stop()
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    mCapturing.store(false);
+
+    if(mFile != nullptr)
+    {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+bool SerialCaptureWriter::IsCapturing()
+{
+    return mCapturing.load();
+}
+
+void SerialCaptureWriter::Record(SerialCaptureDirection direction, const uint8_t* data, size_t length, std::chrono::steady_clock::time_point time)
+{
+    if(!mCapturing.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    if(mFile == nullptr)
+    {
+        return;
+    }
+
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+
+    while(length > 0)
+    {
+        size_t recordLength = length < SERIAL_CAPTURE_MAXIMUM_RECORD_LENGTH ? length : SERIAL_CAPTURE_MAXIMUM_RECORD_LENGTH;
+        uint8_t header[SERIAL_CAPTURE_RECORD_HEADER_SIZE];
+
+        for(size_t i = 0; i < 8; i++)
+        {
+            header[i] = (uint8_t)(timestamp >> (8 * i));
+        }
+
+        header[8] = (uint8_t)direction;
+        header[9] = (uint8_t)(recordLength & 0xff);
+        header[10] = (uint8_t)(recordLength >> 8);
+
+        fwrite(header, 1, SERIAL_CAPTURE_RECORD_HEADER_SIZE, mFile);
+        fwrite(data, 1, recordLength, mFile);
+
+        mCapturedByteCount.fetch_add(recordLength, std::memory_order_relaxed);
+
+        data += recordLength;
+        length -= recordLength;
+    }
+
+    //the traffic is low, flushing every record keeps the capture complete if the driver crashes.
+    fflush(mFile);
+}
+
+uint64_t SerialCaptureWriter::GetCapturedByteCount()
+{
+    return mCapturedByteCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,103 @@
+/*
+ * SerialCaptureWriter.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SERIALCAPTUREWRITER_H_INCLUDED_
+#define _SERIALCAPTUREWRITER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include "config.h"
+
+//first bytes of a capture file.
+#define SERIAL_CAPTURE_MAGIC "EXOSCAP1"
+#define SERIAL_CAPTURE_MAGIC_SIZE (8)
+
+//bytes preceding the data of a record: timestamp (8), direction (1), length (2).
+#define SERIAL_CAPTURE_RECORD_HEADER_SIZE (11)
+
+//maximum number of data bytes per record, longer chunks are split.
+#define SERIAL_CAPTURE_MAXIMUM_RECORD_LENGTH (0xffff)
+
+namespace SerialDeviceControl
+{
+//Direction of the bytes of a capture record.
+enum SerialCaptureDirection
+{
+    //bytes read from the serial device.
+    CaptureReceived = 0,
+    //bytes written to the serial device.
+    CaptureTransmitted = 1
+};
+
+//Appends the byte chunks exchanged with the serial device to a binary capture file.
+//The file starts with SERIAL_CAPTURE_MAGIC, followed by the records:
+//-timestamp: nanoseconds of the steady clock, 8 bytes little endian,
+//-direction: SerialCaptureDirection, 1 byte,
+//-length: number of data bytes, 2 bytes little endian,
+//-the data bytes.
+//Records may be added by several threads, while not capturing Record returns without locking.
+class SerialCaptureWriter
+{
+    public:
+        SerialCaptureWriter();
+
+        virtual ~SerialCaptureWriter();
+
+        //Start appending to the capture file provided, it is created if it does not exist.
+        //returns false if the file could not be opened.
+        bool Start(const std::string &path);
+
+        //Stop capturing and close the file.
+        void Stop();
+
+        //Returns true while capturing.
+        bool IsCapturing();
+
+        //Append the bytes provided as a record, the time is the time the bytes were read or written.
+        void Record(SerialCaptureDirection direction, const uint8_t* data, size_t length, std::chrono::steady_clock::time_point time);
+
+        //Returns the number of data bytes captured since the last start.
+        uint64_t GetCapturedByteCount();
+
+    private:
+        //serializes the records of the reader and the transmit thread.
+        std::mutex mMutex;
+
+        //the capture file, nullptr while not capturing.
+        FILE* mFile;
+
+        //set while capturing, checked before locking.
+        std::atomic<bool> mCapturing;
+
+        std::atomic<uint64_t> mCapturedByteCount;
+
+        //no copies, the file is owned by this instance.
+        SerialCaptureWriter(const SerialCaptureWriter&);
+        SerialCaptureWriter& operator=(const SerialCaptureWriter&);
+};
+}
+#endif
@@ -52,7 +52,11 @@ using SerialDeviceControl::SerialCommand;
 #define ERROR_INVALID_DIRECTION ("the direction provided is invalid!")
 
 
-uint8_t SerialCommand::MessageHeader[4] = {0x55, 0xaa, 0x01, 0x09};
+constexpr uint8_t SerialCommand::MessageHeader[MESSAGE_HEADER_SIZE];
+constexpr SerialDeviceControl::MessageFrame SerialCommand::DisconnectCommandFrame;
+constexpr SerialDeviceControl::MessageFrame SerialCommand::StopMotionCommandFrame;
+constexpr SerialDeviceControl::MessageFrame SerialCommand::ParkCommandFrame;
+constexpr SerialDeviceControl::MessageFrame SerialCommand::GetSiteLocationCommandFrame;
 
 void SerialCommand::PushHeader(
         std::vector<uint8_t> &buffer
@@ -64,32 +68,39 @@ void SerialCommand::PushHeader(
     buffer.push_back(SerialCommand::MessageHeader[3]);
 }
 
-void SerialCommand::push_bytes(
-        std::vector<uint8_t> &buffer,
-        uint8_t byte,
-        size_t count
+void SerialCommand::put_header(
+        MessageFrame &frame,
+        SerialCommandID command
         )
 {
-    if(count < 1)
-    {
-        return;
-    }
+    frame.fill(0x00);
 
-    for(size_t i = 0; i < count; i++)
-    {
-        buffer.push_back(byte);
-    }
+    frame[0] = SerialCommand::MessageHeader[0];
+    frame[1] = SerialCommand::MessageHeader[1];
+    frame[2] = SerialCommand::MessageHeader[2];
+    frame[3] = SerialCommand::MessageHeader[3];
+
+    frame[4] = command;
 }
 
-void SerialCommand::push_float_bytes(
-        std::vector<uint8_t> &buffer,
+void SerialCommand::put_float_bytes(
+        MessageFrame &frame,
+        size_t offset,
         FloatByteConverter &values
         )
 {
-    buffer.push_back(values.bytes[0]);
-    buffer.push_back(values.bytes[1]);
-    buffer.push_back(values.bytes[2]);
-    buffer.push_back(values.bytes[3]);
+    frame[offset + 0] = values.bytes[0];
+    frame[offset + 1] = values.bytes[1];
+    frame[offset + 2] = values.bytes[2];
+    frame[offset + 3] = values.bytes[3];
+}
+
+void SerialCommand::push_frame(
+        std::vector<uint8_t> &buffer,
+        const MessageFrame &frame
+        )
+{
+    buffer.insert(buffer.end(), frame.begin(), frame.end());
 }
 
 //The following two commands are the simplest. They only consist of the header and the command id, padding the remaining bytes with zeros.
@@ -98,11 +109,7 @@ bool SerialCommand::GetDisconnectCommandMessage(
     std::vector<uint8_t> &buffer
     )
 {
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::DISCONNET_COMMAND_ID);
-
-    push_bytes(buffer, 0x00, 8);
+    push_frame(buffer, DisconnectCommandFrame);
 
     return true;
 }
@@ -113,11 +120,7 @@ bool SerialCommand::GetStopMotionCommandMessage(
         std::vector<uint8_t> &buffer
         )
 {
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::STOP_MOTION_COMMAND_ID);
-
-    push_bytes(buffer, 0x00, 8);
+    push_frame(buffer, StopMotionCommandFrame);
 
     return true;
 }
@@ -127,11 +130,7 @@ bool SerialCommand::GetParkCommandMessage(
         std::vector<uint8_t> &buffer
         )
 {
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::PARK_COMMAND_ID);
-
-    push_bytes(buffer, 0x00, 8);
+    push_frame(buffer, ParkCommandFrame);
 
     return true;
 }
@@ -140,18 +139,14 @@ bool SerialCommand::GetGetSiteLocationCommandMessage(
         std::vector<uint8_t> &buffer
         )
 {
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::GET_SITE_LOCATION_COMMAND_ID);
-
-    push_bytes(buffer, 0x00, 8);
+    push_frame(buffer, GetSiteLocationCommandFrame);
 
     return true;
 }
 
 //This command slews the telescope to the coordinates provided. It is autonomous, and the change of slewing speeds are not allowed.
-bool SerialCommand::GetGotoCommandMessage(
-        std::vector<uint8_t> &buffer,
+bool SerialCommand::GetGotoCommandFrame(
+        MessageFrame &frame,
         float decimal_right_ascension,
         float decimal_declination
         )
@@ -172,9 +167,7 @@ bool SerialCommand::GetGotoCommandMessage(
         return false;
     }
 
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::GOTO_COMMAND_ID);
+    put_header(frame, SerialCommandID::GOTO_COMMAND_ID);
 
     FloatByteConverter ra_bytes;
     FloatByteConverter dec_bytes;
@@ -182,15 +175,15 @@ bool SerialCommand::GetGotoCommandMessage(
     ra_bytes.decimal_number = decimal_right_ascension;
     dec_bytes.decimal_number = decimal_declination;
 
-    push_float_bytes(buffer, ra_bytes);
-    push_float_bytes(buffer, dec_bytes);
+    put_float_bytes(frame, 5, ra_bytes);
+    put_float_bytes(frame, 9, dec_bytes);
 
     return true;
 }
 
 //This command syncs the telescope to the coordinates provided. It should be useful when doing plate solvings.
-bool SerialCommand::GetSyncCommandMessage(
-        std::vector<uint8_t> &buffer,
+bool SerialCommand::GetSyncCommandFrame(
+        MessageFrame &frame,
         float decimal_right_ascension,
         float decimal_declination
         )
@@ -211,9 +204,7 @@ bool SerialCommand::GetSyncCommandMessage(
         return false;
     }
 
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::SYNC_COMMAND_ID);
+    put_header(frame, SerialCommandID::SYNC_COMMAND_ID);
 
     FloatByteConverter ra_bytes;
     FloatByteConverter dec_bytes;
@@ -221,15 +212,15 @@ bool SerialCommand::GetSyncCommandMessage(
     ra_bytes.decimal_number = decimal_right_ascension;
     dec_bytes.decimal_number = decimal_declination;
 
-    push_float_bytes(buffer, ra_bytes);
-    push_float_bytes(buffer, dec_bytes);
+    put_float_bytes(frame, 5, ra_bytes);
+    put_float_bytes(frame, 9, dec_bytes);
 
     return true;
 }
 
 //This sets the site location of the mount, it just supports longitude and latitude, but no elevation.
-bool SerialCommand::GetSetSiteLocationCommandMessage(
-        std::vector<uint8_t> &buffer,
+bool SerialCommand::GetSetSiteLocationCommandFrame(
+        MessageFrame &frame,
         float decimal_latitude,
         float decimal_longitude
         )
@@ -250,9 +241,7 @@ bool SerialCommand::GetSetSiteLocationCommandMessage(
         return false;
     }
 
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::SET_SITE_LOCATION_COMMAND_ID);
+    put_header(frame, SerialCommandID::SET_SITE_LOCATION_COMMAND_ID);
 
     FloatByteConverter lat_bytes;
     FloatByteConverter lon_bytes;
@@ -260,8 +249,8 @@ bool SerialCommand::GetSetSiteLocationCommandMessage(
     lat_bytes.decimal_number = decimal_latitude;
     lon_bytes.decimal_number = decimal_longitude;
 
-    push_float_bytes(buffer, lon_bytes);
-    push_float_bytes(buffer, lat_bytes);
+    put_float_bytes(frame, 5, lon_bytes);
+    put_float_bytes(frame, 9, lat_bytes);
 
     return true;
 }
@@ -269,8 +258,8 @@ bool SerialCommand::GetSetSiteLocationCommandMessage(
 //This message sets the dates and time of the telescope mount, the values are simple binary coded decimals (BCD).
 //Also the controller accepts any value, even if it is incorrect eg. 99:99:99 as a time and 9999-99-99 are possible, so checking for validity is encouraged.
 //further a check for leap years is advisable.
-bool SerialCommand::GetSetDateTimeCommandMessage(
-        std::vector<uint8_t> &buffer,
+bool SerialCommand::GetSetDateTimeCommandFrame(
+        MessageFrame &frame,
         uint16_t year,
         uint8_t month,
         uint8_t day,
@@ -402,9 +391,7 @@ bool SerialCommand::GetSetDateTimeCommandMessage(
         //leap year.
     }
 
-    PushHeader(buffer);
-
-    buffer.push_back(SerialCommandID::SET_DATE_TIME_COMMAND_ID);
+    put_header(frame, SerialCommandID::SET_DATE_TIME_COMMAND_ID);
 
     //when received the incomming byte is offset by -12 for some reason, so adjust for this. probably offset sign handling.
    
@@ -415,27 +402,27 @@ bool SerialCommand::GetSetDateTimeCommandMessage(
     uint8_t local_day = (uint8_t)day;
     
     //TODO: Be aware, the firmware only supports dates prior to 10000-01-01, please fix this at the appropriate time!
-    buffer.push_back(local_hiYear);
-    buffer.push_back(local_loYear);
-    buffer.push_back(local_month);
-    buffer.push_back(local_day);
+    frame[5] = local_hiYear;
+    frame[6] = local_loYear;
+    frame[7] = local_month;
+    frame[8] = local_day;
 
     uint8_t local_hour   = (uint8_t)hour;
     uint8_t local_minute = (uint8_t)minute;
     uint8_t local_second = (uint8_t)second;
     uint8_t utc_shift    = (uint8_t)(utc_offset + 12);
     
-    buffer.push_back(local_hour); //handbox uses local time as your clock shows, and calculates back to the UTC from that.
-    buffer.push_back(local_minute);
-    buffer.push_back(local_second);
-    buffer.push_back(utc_shift); //TODO: offset range limiting...
+    frame[9] = local_hour; //handbox uses local time as your clock shows, and calculates back to the UTC from that.
+    frame[10] = local_minute;
+    frame[11] = local_second;
+    frame[12] = utc_shift; //TODO: offset range limiting...
 
     return true;
 }
 
 //move the telescope in a certain direction. Use the first 4 command IDs for a particular direction.
-bool SerialCommand::GetMoveWhileTrackingCommandMessage(
-        std::vector<uint8_t> &buffer,
+bool SerialCommand::GetMoveWhileTrackingCommandFrame(
+        MessageFrame &frame,
         SerialCommandID direction
         )
 {
@@ -447,14 +434,149 @@ bool SerialCommand::GetMoveWhileTrackingCommandMessage(
         return false;
     }
 
-    PushHeader(buffer);
-    buffer.push_back(direction);
+    put_header(frame, direction);
+
+    frame[5] = 0xC8;
+    frame[9] = 0xC8;
+
+    return true;
+}
+
+//The vector based encoders append the frame built by the allocation free encoders.
+bool SerialCommand::GetGotoCommandMessage(
+        std::vector<uint8_t> &buffer,
+        float decimal_right_ascension,
+        float decimal_declination
+        )
+{
+    MessageFrame frame;
+
+    if(!GetGotoCommandFrame(frame, decimal_right_ascension, decimal_declination))
+    {
+        return false;
+    }
+
+    push_frame(buffer, frame);
+
+    return true;
+}
+
+bool SerialCommand::GetSyncCommandMessage(
+        std::vector<uint8_t> &buffer,
+        float decimal_right_ascension,
+        float decimal_declination
+        )
+{
+    MessageFrame frame;
+
+    if(!GetSyncCommandFrame(frame, decimal_right_ascension, decimal_declination))
+    {
+        return false;
+    }
+
+    push_frame(buffer, frame);
+
+    return true;
+}
+
+bool SerialCommand::GetSetSiteLocationCommandMessage(
+        std::vector<uint8_t> &buffer,
+        float decimal_latitude,
+        float decimal_longitude
+        )
+{
+    MessageFrame frame;
+
+    if(!GetSetSiteLocationCommandFrame(frame, decimal_latitude, decimal_longitude))
+    {
+        return false;
+    }
+
+    push_frame(buffer, frame);
 
-    buffer.push_back(0xC8);
-    push_bytes(buffer, 0x00, 3);
+    return true;
+}
 
-    buffer.push_back(0xC8);
-    push_bytes(buffer, 0x00, 3);
+bool SerialCommand::GetSetDateTimeCommandMessage(
+        std::vector<uint8_t> &buffer,
+        uint16_t year,
+        uint8_t month,
+        uint8_t day,
+        uint8_t hour,
+        uint8_t minute,
+        uint8_t second,
+        int8_t utc_offset
+        )
+{
+    MessageFrame frame;
+
+    if(!GetSetDateTimeCommandFrame(frame, year, month, day, hour, minute, second, utc_offset))
+    {
+        return false;
+    }
+
+    push_frame(buffer, frame);
 
     return true;
 }
+
+bool SerialCommand::GetMoveWhileTrackingCommandMessage(
+        std::vector<uint8_t> &buffer,
+        SerialCommandID direction
+        )
+{
+    MessageFrame frame;
+
+    if(!GetMoveWhileTrackingCommandFrame(frame, direction))
+    {
+        return false;
+    }
+
+    push_frame(buffer, frame);
+
+    return true;
+}
+
+using SerialDeviceControl::FrameBatch;
+
+FrameBatch::FrameBatch(uint16_t interFrameGap) :
+    mFrames(),
+    mCount(0),
+    mInterFrameGap(interFrameGap)
+{
+
+}
+
+//Append a frame to the batch, returns false if the batch is full.
+bool FrameBatch::Add(const MessageFrame &frame)
+{
+    if(mCount >= FRAME_BATCH_CAPACITY)
+    {
+        return false;
+    }
+
+    mFrames[mCount] = frame;
+    mCount++;
+
+    return true;
+}
+
+void FrameBatch::Clear()
+{
+    mCount = 0;
+}
+
+size_t FrameBatch::Count() const
+{
+    return mCount;
+}
+
+const SerialDeviceControl::MessageFrame &FrameBatch::At(size_t index) const
+{
+    return mFrames[index];
+}
+
+uint16_t FrameBatch::GetInterFrameGap() const
+{
+    return mInterFrameGap;
+}
@@ -26,6 +26,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <chrono>
 #include <cmath>
 #include <ctime>
@@ -34,6 +35,11 @@
 
 #define MESSAGE_FRAME_SIZE (13)
 
+#define MESSAGE_HEADER_SIZE (4)
+
+//maximum number of frames sent as one batch.
+#define FRAME_BATCH_CAPACITY (8)
+
 namespace SerialDeviceControl
 {
 //After determining the message frame size and structure,
@@ -96,8 +102,8 @@ enum SerialCommandID
 //Simple data structure for a coordinate pair.
 struct EquatorialCoordinates
 {
-    //The time stamp when this coordinates where received.
-    std::chrono::time_point<std::chrono::system_clock> TimeStamp;
+    //The monotonic time stamp when the first byte of the report carrying these coordinates was read.
+    std::chrono::steady_clock::time_point TimeStamp;
 
     //decimal value of the right ascension.
     float RightAscension;
@@ -143,6 +149,9 @@ enum DateMonths
     December = 12,
 };
 
+//fixed size message frame, encoding into it does not allocate memory.
+typedef std::array<uint8_t, MESSAGE_FRAME_SIZE> MessageFrame;
+
 //helper union to read out float bytes without the hazzle with pointers
 union FloatByteConverter
 {
@@ -159,18 +168,32 @@ union FloatByteConverter
 class SerialCommand
 {
     private:
+        //helper function writing the header and the command id into the frame, padding the remaining bytes with zeros.
+        static void put_header(MessageFrame &frame, SerialCommandID command);
 
+        //helper function to put the float values into the frame starting at the offset provided.
+        static void put_float_bytes(MessageFrame &frame, size_t offset, FloatByteConverter &values);
 
-        //helper function pushing a number of bytes into the buffer, for padding.
-        static void push_bytes(std::vector<uint8_t> &buffer, uint8_t byte, size_t count);
+        //helper function appending a frame to the buffer.
+        static void push_frame(std::vector<uint8_t> &buffer, const MessageFrame &frame);
 
+    public:
         //simple constant containing the message header as of firmware V2.3.
-        static uint8_t MessageHeader[4];
+        static constexpr uint8_t MessageHeader[MESSAGE_HEADER_SIZE] = {0x55, 0xaa, 0x01, 0x09};
 
-        //helper function to push the float values into the buffer
-        static void push_float_bytes(std::vector<uint8_t> &buffer, FloatByteConverter &values);
+        //Pre-built frames of the commands without arguments, ready to be sent.
+        //Gracefully disconnect from the GoTo Controller.
+        static constexpr MessageFrame DisconnectCommandFrame = {{0x55, 0xaa, 0x01, 0x09, SerialCommandID::DISCONNET_COMMAND_ID, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+
+        //Stop the telescope motion.
+        static constexpr MessageFrame StopMotionCommandFrame = {{0x55, 0xaa, 0x01, 0x09, SerialCommandID::STOP_MOTION_COMMAND_ID, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+
+        //Slew the telescope to the park position.
+        static constexpr MessageFrame ParkCommandFrame = {{0x55, 0xaa, 0x01, 0x09, SerialCommandID::PARK_COMMAND_ID, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
+
+        //Request the site location from the controller.
+        static constexpr MessageFrame GetSiteLocationCommandFrame = {{0x55, 0xaa, 0x01, 0x09, SerialCommandID::GET_SITE_LOCATION_COMMAND_ID, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
-    public:
         //Gracefully disconnect from the GoTo Controller.
         //returns false if an error occurs.
         static bool GetDisconnectCommandMessage(std::vector<uint8_t> &buffer);
@@ -208,10 +231,61 @@ class SerialCommand
         //move the telescope in a certain direction. Use the first 4 command IDs for a particular direction.
         static bool GetMoveWhileTrackingCommandMessage(std::vector<uint8_t> &buffer, SerialCommandID direction);
 
+        //Allocation free encoders, writing the message into the fixed size frame provided.
+        //The frame is left untouched and false is returned if an argument is invalid.
+        //put the goto message corresponding to the coordinates provided into the frame provided.
+        static bool GetGotoCommandFrame(MessageFrame &frame, float decimal_right_ascension, float decimal_declination);
+
+        //put the sync message corresponding to the coordinates provided into the frame provided.
+        static bool GetSyncCommandFrame(MessageFrame &frame, float decimal_right_ascension, float decimal_declination);
+
+        //put the set site location message corresponding the coordinates provided into the frame provided
+        static bool GetSetSiteLocationCommandFrame(MessageFrame &frame, float decimal_latitude, float decimal_longitude);
+
+        //put the date time message corresponding to the time/date provided into the frame provided.
+        static bool GetSetDateTimeCommandFrame(MessageFrame &frame, uint16_t year, uint8_t month, uint8_t day,
+                                               uint8_t hour, uint8_t minute, uint8_t second, int8_t utc_offset);
+
+        //move the telescope in a certain direction. Use the first 4 command IDs for a particular direction.
+        static bool GetMoveWhileTrackingCommandFrame(MessageFrame &frame, SerialCommandID direction);
+
         //helper function pushing the header into the buffer.
         static void PushHeader(std::vector<uint8_t> &buffer);
+};
+
+//Sequence of frames sent back to back, e.g. setting date, time and site location in one go.
+//Without an inter frame gap the frames are written by a single write to the serial device.
+class FrameBatch
+{
+    public:
+        //Create an empty batch, optionally waiting the gap provided in milliseconds between the frames.
+        FrameBatch(uint16_t interFrameGap = 0);
+
+        //Append a frame to the batch.
+        //returns false if the batch is full.
+        bool Add(const MessageFrame &frame);
+
+        //Remove all frames from the batch.
+        void Clear();
+
+        //returns the number of frames in the batch.
+        size_t Count() const;
+
+        //returns the frame at the index provided.
+        const MessageFrame &At(size_t index) const;
+
+        //returns the gap in milliseconds waited between the frames.
+        uint16_t GetInterFrameGap() const;
+
+    private:
+        //the frames of the batch.
+        std::array<MessageFrame, FRAME_BATCH_CAPACITY> mFrames;
 
+        //number of frames used.
+        size_t mCount;
 
+        //milliseconds between two frames.
+        uint16_t mInterFrameGap;
 };
 }
 
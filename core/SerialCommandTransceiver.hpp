@@ -0,0 +1,495 @@
+/*
+ * SerialCommandTransceiver.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SERIALCOMMANDTRANSCEIVER_H_INCLUDED_
+#define _SERIALCOMMANDTRANSCEIVER_H_INCLUDED_
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <cerrno>
+#include <poll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "config.h"
+#include "INotifyPointingCoordinatesReceived.hpp"
+#include "ISerialInterface.hpp"
+#include "CriticalData.hpp"
+#include "SerialCommand.hpp"
+#include "SpscRingBuffer.hpp"
+#include "FrameSynchronizer.hpp"
+#include "EventNotifier.hpp"
+#include "TransmitScheduler.hpp"
+#include "SerialLinkMetrics.hpp"
+#include "LatencyHistogram.hpp"
+#include "SerialCaptureWriter.hpp"
+
+//if the serial device reports an error condition (e.g. unplugged adapter) wait this long before polling it again.
+#define SERIAL_ERROR_RETRY_TIMEOUT (500)
+
+//maximum number of bytes fetched from the serial device per read.
+#define SERIAL_RECEIVE_CHUNK_SIZE (256)
+
+//number of bytes the receiver queue holds until the dispatch thread has to catch up, has to be a power of two.
+#define SERIAL_RECEIVE_QUEUE_SIZE (4096)
+
+//number of read marks queued, every mark covers at least one queued byte, so the marks never overflow.
+#define SERIAL_READ_MARK_QUEUE_SIZE (SERIAL_RECEIVE_QUEUE_SIZE)
+
+namespace SerialDeviceControl
+{
+//Length and read time of a block of bytes queued by the reader thread.
+struct SerialReadMark
+{
+    //number of bytes queued by the read.
+    size_t Length;
+
+    //time the bytes were read from the serial device.
+    std::chrono::steady_clock::time_point ReadTime;
+};
+
+//These types have to inherit/implement:
+//-The ISerialInterface.hpp as Interface type.
+//-The INotifyPointingCoordinatesReceived.hpp as callback type
+template<class InterfaceType, class CallbackType>
+class SerialCommandTransceiver
+{
+    public:
+        //Create the serial transceiver according to provided template parameters. Requires references of the data received interface implementation and the serial interface implementation.
+        SerialCommandTransceiver(
+            InterfaceType &interfaceImplementation,
+            CallbackType &dataReceivedCallback
+            ) :
+            mInterfaceImplementation(interfaceImplementation),
+            mDataReceivedCallback(dataReceivedCallback),
+            mThreadRunning(false),
+            mSerialReceiverBuffer(),
+            mSerialReaderThread(),
+            mDispatchThread(),
+            mFrameSynchronizer(*this),
+            mTransmitScheduler(interfaceImplementation, mCaptureWriter, mLinkMetrics)
+        {
+
+        }
+
+        //Destroys this transceiver, and stops the thread pulling the serial data from the mount.
+        virtual ~SerialCommandTransceiver()
+        {
+            bool threadRunning = mThreadRunning.Get();
+
+            if(threadRunning)
+            {
+                Stop();
+            }
+        }
+        //Start the serial command dispatching.
+        //The reader thread only moves bytes from the serial device to the receiver queue,
+        //the dispatch thread parses them and runs the callbacks, so slow callbacks never delay reading.
+        virtual bool Start()
+        {
+            if(mThreadRunning.Get())
+            {
+                return false;
+            }
+
+            //drop stale data and partial frames of a previous session, no thread is accessing them yet.
+            mSerialReceiverBuffer.Consume(mSerialReceiverBuffer.Size());
+            mSerialReadMarks.Consume(mSerialReadMarks.Size());
+            mFrameSynchronizer.Reset();
+            mLinkMetrics.Reset();
+            mReadToDecodeLatency.Reset();
+
+            mThreadRunning.Set(true);
+
+            mSerialReaderThread = std::thread(&SerialCommandTransceiver::SerialReaderThreadFunction, this);
+            mDispatchThread = std::thread(&SerialCommandTransceiver::DispatchThreadFunction, this);
+
+            mTransmitScheduler.Start();
+
+            return true;
+        }
+
+        //Stop the serial command dispatching.
+        bool Stop()
+        {
+            bool running = mThreadRunning.Get();
+
+            if(running)
+            {
+                //send the frames still queued (e.g. the disconnect message) while the interface is open.
+                mTransmitScheduler.Stop();
+
+                mThreadRunning.Set(false);
+
+                //wake up the threads blocking in poll.
+                mStopEvent.Signal();
+                mDataReceivedEvent.Signal();
+
+                mSerialReaderThread.join();
+                mDispatchThread.join();
+
+                //reset the events so the transceiver can be restarted.
+                mStopEvent.Clear();
+                mDataReceivedEvent.Clear();
+            }
+
+            return true;
+        }
+
+        //Returns the number of received bytes dropped, since the dispatch thread fell behind and the receiver queue was full.
+        uint64_t GetReceiveOverflowByteCount()
+        {
+            return mSerialReceiverBuffer.GetDroppedCount();
+        }
+
+        //Returns how often received data did not fit into the receiver queue.
+        uint64_t GetReceiveOverflowCount()
+        {
+            return mSerialReceiverBuffer.GetOverflowCount();
+        }
+
+        //Returns the number of received bytes dropped since they were not part of a valid message.
+        uint64_t GetJunkByteCount()
+        {
+            return mFrameSynchronizer.GetJunkByteCount();
+        }
+
+        //Fill the snapshot provided with the health metrics of the serial link.
+        void GetLinkStatistics(SerialLinkStatistics &statistics)
+        {
+            mLinkMetrics.GetStatistics(statistics);
+
+            statistics.PositionReportsReceived = mLinkMetrics.GetFrameCount(SerialCommandID::TELESCOPE_POSITION_REPORT_COMMAND_ID);
+            statistics.SiteLocationReportsReceived = mLinkMetrics.GetFrameCount(SerialCommandID::TELESCOPE_SITE_LOCATION_REPORT_COMMAND_ID);
+            statistics.JunkBytes = mFrameSynchronizer.GetJunkByteCount();
+            statistics.OverflowBytes = mSerialReceiverBuffer.GetDroppedCount();
+            statistics.WriteFailures = mTransmitScheduler.GetWriteFailureCount();
+            statistics.RejectedFrames = mTransmitScheduler.GetRejectedFrameCount();
+        }
+
+        //Returns the latencies from reading the last byte of a frame to decoding it.
+        LatencyHistogram &GetReadToDecodeLatency()
+        {
+            return mReadToDecodeLatency;
+        }
+
+        //Start appending the bytes received and transmitted to the capture file provided, may be called at any time.
+        //returns false if the file could not be opened.
+        bool StartCapture(const std::string &path)
+        {
+            return mCaptureWriter.Start(path);
+        }
+
+        //Stop capturing and close the capture file.
+        void StopCapture()
+        {
+            mCaptureWriter.Stop();
+        }
+
+        //Returns true while capturing.
+        bool IsCapturing()
+        {
+            return mCaptureWriter.IsCapturing();
+        }
+
+        //Returns the number of frames written to the serial interface.
+        uint64_t GetSentFrameCount()
+        {
+            return mTransmitScheduler.GetSentFrameCount();
+        }
+
+        //Returns the number of queued frames dropped, since a later frame superseded them.
+        uint64_t GetCoalescedFrameCount()
+        {
+            return mTransmitScheduler.GetCoalescedFrameCount();
+        }
+
+        //Returns the number of frames not queued, since the transmit queue of their priority class was full.
+        uint64_t GetRejectedFrameCount()
+        {
+            return mTransmitScheduler.GetRejectedFrameCount();
+        }
+
+        //Returns the number of frames the serial interface failed to write.
+        uint64_t GetWriteFailureCount()
+        {
+            return mTransmitScheduler.GetWriteFailureCount();
+        }
+
+    protected:
+        //Queue a single message frame to be sent by the transmit scheduler, according to its priority.
+        //The delivery provided (if any) counts whether the frame was written.
+        //Returns false if the frame could not be queued.
+        bool SendMessageFrame(const MessageFrame &frame, TransmitPriority priority,
+                              const std::shared_ptr<FrameDelivery> &delivery = std::shared_ptr<FrameDelivery>())
+        {
+            return mTransmitScheduler.Enqueue(frame, priority, delivery);
+        }
+
+        //Queue the frames of the batch to be sent back to back, according to the priority.
+        //Returns false if the batch could not be queued.
+        bool SendMessageBatch(const FrameBatch &batch, TransmitPriority priority)
+        {
+            return mTransmitScheduler.EnqueueBatch(batch, priority);
+        }
+
+        //Drop the frames of a priority class which are not sent yet.
+        void DiscardMessageFrames(TransmitPriority priority)
+        {
+            mTransmitScheduler.Discard(priority);
+        }
+
+    private:
+        //Reference to the serial implementation.
+        InterfaceType &mInterfaceImplementation;
+
+        //Reference to the data received interface.
+        CallbackType &mDataReceivedCallback;
+
+        //mutex locked running state variable, if set to false the serial receiver thread is terminated.
+        CriticalData<bool> mThreadRunning;
+
+        //Lock free queue handing the received bytes from the reader thread to the dispatch thread.
+        SpscRingBuffer<uint8_t, SERIAL_RECEIVE_QUEUE_SIZE> mSerialReceiverBuffer;
+
+        //bytes fetched from the serial device by a single read.
+        uint8_t mReceiveChunk[SERIAL_RECEIVE_CHUNK_SIZE];
+
+        //movable thread object to control.
+        std::thread mSerialReaderThread;
+
+        //thread parsing the received bytes and notifying the callback.
+        std::thread mDispatchThread;
+
+        //signaled to interrupt the reader thread waiting for serial data.
+        EventNotifier mStopEvent;
+
+        //signaled by the reader thread each time new bytes are queued.
+        EventNotifier mDataReceivedEvent;
+
+        //framing state machine, piecing together the messages from the received bytes.
+        FrameSynchronizer<SerialCommandTransceiver> mFrameSynchronizer;
+
+        //the synchronizer emits the complete frames to OnFrameReceived.
+        friend class FrameSynchronizer<SerialCommandTransceiver>;
+
+        //records the received and transmitted bytes while capturing, used by the transmit scheduler.
+        SerialCaptureWriter mCaptureWriter;
+
+        //prioritizes and paces the frames sent to the serial device.
+        TransmitScheduler<InterfaceType> mTransmitScheduler;
+
+        //health counters of the serial link.
+        SerialLinkMetrics mLinkMetrics;
+
+        //read time of the queued bytes, handed from the reader thread to the dispatch thread along with the bytes.
+        SpscRingBuffer<SerialReadMark, SERIAL_READ_MARK_QUEUE_SIZE> mSerialReadMarks;
+
+        //read time of the bytes currently fed to the frame synchronizer, only accessed by the dispatch thread.
+        std::chrono::steady_clock::time_point mCurrentReadTime;
+
+        //read time of the first byte of the frame currently collected, only accessed by the dispatch thread.
+        std::chrono::steady_clock::time_point mFrameStartReadTime;
+
+        //latencies from reading a frame to decoding it.
+        LatencyHistogram mReadToDecodeLatency;
+
+        //When messages are received, try parsing them.
+        //It may happen that messages are received in fragments, the frame synchronizer pieces together these fragments to valid messages.
+        //Each byte is fed once to the synchronizer straight from the receiver queue, every complete message is dispatched right away.
+        //The bytes are fed read by read, so every frame is stamped with the read times of its first and its last byte.
+        void TryParseMessagesFromBuffer()
+        {
+            SerialReadMark mark;
+
+            while(mSerialReadMarks.Peek(&mark, 1) == 1)
+            {
+                mCurrentReadTime = mark.ReadTime;
+
+                BufferSegments<uint8_t> received = mSerialReceiverBuffer.ReadableSegments();
+
+                size_t firstLength = std::min(mark.Length, received.First.Length);
+                size_t secondLength = std::min(mark.Length - firstLength, received.Second.Length);
+
+                mFrameSynchronizer.Push(received.First.Data, firstLength);
+                mFrameSynchronizer.Push(received.Second.Data, secondLength);
+
+                mSerialReceiverBuffer.Consume(firstLength + secondLength);
+                mSerialReadMarks.Consume(1);
+            }
+        }
+
+        //Called by the frame synchronizer when a frame may start, remembers the read time of its first byte.
+        void OnFrameStarted()
+        {
+            mFrameStartReadTime = mCurrentReadTime;
+        }
+
+        //Called by the frame synchronizer for every complete message, decodes it and notifies the callback.
+        void OnFrameReceived(const uint8_t* frame)
+        {
+            FloatByteConverter ra_bytes;
+            FloatByteConverter dec_bytes;
+
+            ra_bytes.bytes[0] = frame[5];
+            ra_bytes.bytes[1] = frame[6];
+            ra_bytes.bytes[2] = frame[7];
+            ra_bytes.bytes[3] = frame[8];
+
+            dec_bytes.bytes[0] = frame[9];
+            dec_bytes.bytes[1] = frame[10];
+            dec_bytes.bytes[2] = frame[11];
+            dec_bytes.bytes[3] = frame[12];
+
+            uint8_t cid = frame[4];
+            float ra = ra_bytes.decimal_number;
+            float dec = dec_bytes.decimal_number;
+
+            FrameTiming timing;
+            timing.FirstByteReadTime = mFrameStartReadTime;
+            timing.ReadTime = mCurrentReadTime;
+            timing.DecodeTime = std::chrono::steady_clock::now();
+
+            mReadToDecodeLatency.Record(timing.DecodeTime - timing.ReadTime);
+
+            //std::cerr << "COMMAND RECEIVED:" << std::hex << (int)cid << std::endl;
+
+            mLinkMetrics.AddFrameReceived(cid, std::isnan(ra) || std::isnan(dec), timing.ReadTime);
+
+            //handle specific response.
+            switch(cid)
+            {
+                case SerialCommandID::TELESCOPE_SITE_LOCATION_REPORT_COMMAND_ID:
+                    //std::cout << "new location received!" << std::endl;
+                    mDataReceivedCallback.OnSiteLocationCoordinatesReceived(ra, dec, timing);
+                    break;
+
+                /* The handbox unfortunately does not report "untracked" coordinates, -> reason for this big state machine.
+                 * case SerialCommandID::TELESCOPE_POSITION_REPORT_UNTRACKED_COMMAND_ID:
+                    std::cerr << "untracked pointing report:" << "RA:" << ra << " DEC:" << dec << std::endl;
+                    break;*/
+
+                case SerialCommandID::TELESCOPE_POSITION_REPORT_COMMAND_ID:
+                    mDataReceivedCallback.OnPointingCoordinatesReceived(ra, dec, timing);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        //Endless loop function of the thread used to receive the serial messages of the mount.
+        //The thread blocks in poll until the serial device has data or the stop event is signaled,
+        //and only queues the received bytes for the dispatch thread, there are no wake ups while the line is quiet.
+        void SerialReaderThreadFunction()
+        {
+            std::cerr << "Serial Reader Thread started!" << std::endl;
+
+            mInterfaceImplementation.Open();
+
+            bool running = mThreadRunning.Get();
+
+            while(running)
+            {
+                struct pollfd pollDescriptors[2];
+
+                pollDescriptors[0].fd = mInterfaceImplementation.GetFD();
+                pollDescriptors[0].events = POLLIN;
+                pollDescriptors[0].revents = 0;
+
+                pollDescriptors[1].fd = mStopEvent.GetFD();
+                pollDescriptors[1].events = POLLIN;
+                pollDescriptors[1].revents = 0;
+
+                int result = poll(pollDescriptors, 2, -1);
+
+                if(result < 0 && errno != EINTR)
+                {
+                    std::cerr << "Serial Reader Thread: poll failed!" << std::endl;
+                    mStopEvent.Wait(SERIAL_ERROR_RETRY_TIMEOUT);
+                }
+                else if((pollDescriptors[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+                {
+                    //device is gone or broken, do not spin on the error condition.
+                    mStopEvent.Wait(SERIAL_ERROR_RETRY_TIMEOUT);
+                }
+                else if((pollDescriptors[0].revents & POLLIN) != 0)
+                {
+                    //fetch everything pending with one read, and queue it in one block.
+                    //if the dispatch thread fell behind the excess is dropped and counted by the queue.
+                    size_t bytesRead = mInterfaceImplementation.Read(mReceiveChunk, SERIAL_RECEIVE_CHUNK_SIZE);
+
+                    if(bytesRead > 0)
+                    {
+                        SerialReadMark mark;
+                        mark.ReadTime = std::chrono::steady_clock::now();
+
+                        mLinkMetrics.AddBytesReceived(bytesRead);
+                        mCaptureWriter.Record(CaptureReceived, mReceiveChunk, bytesRead, mark.ReadTime);
+                        mark.Length = mSerialReceiverBuffer.Write(mReceiveChunk, bytesRead);
+
+                        //the mark is queued after the bytes, so the dispatch thread always finds the bytes it covers.
+                        if(mark.Length > 0)
+                        {
+                            mSerialReadMarks.Write(&mark, 1);
+                        }
+
+                        mDataReceivedEvent.Signal();
+                    }
+                }
+
+                running = mThreadRunning.Get();
+            }
+
+            std::cerr << "Serial Reader Thread stopped!" << std::endl;
+            mInterfaceImplementation.Flush();
+            mInterfaceImplementation.Close();
+        }
+
+        //Endless loop function of the thread parsing the received bytes and notifying the callback.
+        void DispatchThreadFunction()
+        {
+            bool running = mThreadRunning.Get();
+
+            while(running)
+            {
+                mDataReceivedEvent.Wait(-1);
+
+                //clear before draining, a signal arriving while draining is not lost but causes another pass.
+                mDataReceivedEvent.Clear();
+
+                TryParseMessagesFromBuffer();
+
+                running = mThreadRunning.Get();
+            }
+        }
+};
+}
+#endif
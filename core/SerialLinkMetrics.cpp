@@ -0,0 +1,165 @@
+/*
+ * SerialLinkMetrics.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SerialLinkMetrics.hpp"
+
+#include <cmath>
+
+using SerialDeviceControl::SerialLinkMetrics;
+
+SerialLinkMetrics::SerialLinkMetrics()
+{
+    Reset();
+}
+
+SerialLinkMetrics::~SerialLinkMetrics()
+{
+
+}
+
+//Reset all counters and statistics, must not race the updating threads.
+void SerialLinkMetrics::Reset()
+{
+    mBytesReceived.store(0);
+    mBytesSent.store(0);
+    mFramesReceived.store(0);
+    mNaNPayloads.store(0);
+
+    for(size_t i = 0; i < SERIAL_COMMAND_ID_COUNT; i++)
+    {
+        mFramesPerCommand[i].store(0);
+    }
+
+    mFrameIntervals.store(0);
+    mMinimumFrameInterval.store(0.0);
+    mMeanFrameInterval.store(0.0);
+    mMaximumFrameInterval.store(0.0);
+    mFrameIntervalJitter.store(0.0);
+
+    mHasLastArrival = false;
+    mLastInterval = 0.0;
+}
+
+void SerialLinkMetrics::AddBytesReceived(size_t count)
+{
+    mBytesReceived.fetch_add(count, std::memory_order_relaxed);
+}
+
+void SerialLinkMetrics::AddBytesSent(size_t count)
+{
+    mBytesSent.fetch_add(count, std::memory_order_relaxed);
+}
+
+//Count the frame, and update the inter frame statistics using the arrival time provided.
+void SerialLinkMetrics::AddFrameReceived(uint8_t commandId, bool nanPayload, std::chrono::steady_clock::time_point arrival)
+{
+    mFramesReceived.fetch_add(1, std::memory_order_relaxed);
+    mFramesPerCommand[commandId].fetch_add(1, std::memory_order_relaxed);
+
+    if(nanPayload)
+    {
+        mNaNPayloads.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(!mHasLastArrival)
+    {
+        mLastArrival = arrival;
+        mHasLastArrival = true;
+        return;
+    }
+
+    double interval = std::chrono::duration<double, std::milli>(arrival - mLastArrival).count();
+    mLastArrival = arrival;
+
+    uint64_t intervals = mFrameIntervals.load(std::memory_order_relaxed) + 1;
+
+    if(intervals == 1)
+    {
+        mMinimumFrameInterval.store(interval, std::memory_order_relaxed);
+        mMaximumFrameInterval.store(interval, std::memory_order_relaxed);
+        mMeanFrameInterval.store(interval, std::memory_order_relaxed);
+    }
+    else
+    {
+        if(interval < mMinimumFrameInterval.load(std::memory_order_relaxed))
+        {
+            mMinimumFrameInterval.store(interval, std::memory_order_relaxed);
+        }
+
+        if(interval > mMaximumFrameInterval.load(std::memory_order_relaxed))
+        {
+            mMaximumFrameInterval.store(interval, std::memory_order_relaxed);
+        }
+
+        //running mean.
+        double mean = mMeanFrameInterval.load(std::memory_order_relaxed);
+        mMeanFrameInterval.store(mean + (interval - mean) / intervals, std::memory_order_relaxed);
+
+        //smoothed deviation of consecutive intervals.
+        double jitter = mFrameIntervalJitter.load(std::memory_order_relaxed);
+        double deviation = std::fabs(interval - mLastInterval);
+        mFrameIntervalJitter.store(jitter + (deviation - jitter) * SERIAL_JITTER_GAIN, std::memory_order_relaxed);
+    }
+
+    mLastInterval = interval;
+    mFrameIntervals.store(intervals, std::memory_order_relaxed);
+}
+
+uint64_t SerialLinkMetrics::GetBytesReceived()
+{
+    return mBytesReceived.load(std::memory_order_relaxed);
+}
+
+uint64_t SerialLinkMetrics::GetBytesSent()
+{
+    return mBytesSent.load(std::memory_order_relaxed);
+}
+
+uint64_t SerialLinkMetrics::GetFrameCount(uint8_t commandId)
+{
+    return mFramesPerCommand[commandId].load(std::memory_order_relaxed);
+}
+
+uint64_t SerialLinkMetrics::GetFrameCount()
+{
+    return mFramesReceived.load(std::memory_order_relaxed);
+}
+
+uint64_t SerialLinkMetrics::GetNaNPayloadCount()
+{
+    return mNaNPayloads.load(std::memory_order_relaxed);
+}
+
+//Fill the received frame counters and the inter frame statistics, the other fields are left untouched.
+void SerialLinkMetrics::GetStatistics(SerialLinkStatistics &statistics)
+{
+    statistics.BytesReceived = GetBytesReceived();
+    statistics.BytesSent = GetBytesSent();
+    statistics.FramesReceived = GetFrameCount();
+    statistics.NaNPayloads = GetNaNPayloadCount();
+
+    statistics.MinimumFrameInterval = mMinimumFrameInterval.load(std::memory_order_relaxed);
+    statistics.MeanFrameInterval = mMeanFrameInterval.load(std::memory_order_relaxed);
+    statistics.MaximumFrameInterval = mMaximumFrameInterval.load(std::memory_order_relaxed);
+    statistics.FrameIntervalJitter = mFrameIntervalJitter.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,141 @@
+/*
+ * SerialLinkMetrics.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SERIALLINKMETRICS_H_INCLUDED_
+#define _SERIALLINKMETRICS_H_INCLUDED_
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include "config.h"
+
+//number of distinct command ids, a command id is one byte.
+#define SERIAL_COMMAND_ID_COUNT (256)
+
+//the jitter estimate follows the interval deviation with this gain (see RFC 3550).
+#define SERIAL_JITTER_GAIN (1.0 / 16.0)
+
+namespace SerialDeviceControl
+{
+//Snapshot of the serial link health, assembled by the transceiver.
+struct SerialLinkStatistics
+{
+    //bytes fetched from the serial device.
+    uint64_t BytesReceived;
+
+    //bytes written to the serial device.
+    uint64_t BytesSent;
+
+    //valid frames received.
+    uint64_t FramesReceived;
+
+    //position reports received.
+    uint64_t PositionReportsReceived;
+
+    //site location reports received.
+    uint64_t SiteLocationReportsReceived;
+
+    //received bytes not being part of a valid frame.
+    uint64_t JunkBytes;
+
+    //bytes dropped since the receiver queue was full.
+    uint64_t OverflowBytes;
+
+    //frames carrying not a number values.
+    uint64_t NaNPayloads;
+
+    //frames the serial device failed to write.
+    uint64_t WriteFailures;
+
+    //frames not queued for sending, since the link was not running or the transmit queue of their priority class was full.
+    uint64_t RejectedFrames;
+
+    //time between two received frames in milliseconds.
+    double MinimumFrameInterval;
+    double MeanFrameInterval;
+    double MaximumFrameInterval;
+    double FrameIntervalJitter;
+};
+
+//Counters of the serial link, updated lock free by the reader, dispatch and transmit threads, readable by any thread.
+//The inter frame statistics are only updated by a single thread, the dispatch thread.
+class SerialLinkMetrics
+{
+    public:
+        SerialLinkMetrics();
+
+        virtual ~SerialLinkMetrics();
+
+        //Reset all counters and statistics.
+        void Reset();
+
+        //Count bytes fetched from the serial device.
+        void AddBytesReceived(size_t count);
+
+        //Count bytes the serial device reported as written.
+        void AddBytesSent(size_t count);
+
+        //Count a received frame with the command id and its payload state, and update the inter frame statistics.
+        void AddFrameReceived(uint8_t commandId, bool nanPayload, std::chrono::steady_clock::time_point arrival);
+
+        //Returns the number of bytes fetched from the serial device.
+        uint64_t GetBytesReceived();
+
+        //Returns the number of bytes written to the serial device.
+        uint64_t GetBytesSent();
+
+        //Returns the number of received frames of the command id provided.
+        uint64_t GetFrameCount(uint8_t commandId);
+
+        //Returns the number of all received frames.
+        uint64_t GetFrameCount();
+
+        //Returns the number of frames carrying not a number values.
+        uint64_t GetNaNPayloadCount();
+
+        //Fill the received frame counters and the inter frame statistics of the snapshot.
+        void GetStatistics(SerialLinkStatistics &statistics);
+
+    private:
+        std::atomic<uint64_t> mBytesReceived;
+        std::atomic<uint64_t> mBytesSent;
+        std::atomic<uint64_t> mFramesReceived;
+        std::atomic<uint64_t> mNaNPayloads;
+        std::atomic<uint64_t> mFramesPerCommand[SERIAL_COMMAND_ID_COUNT];
+
+        //inter frame statistics in milliseconds, written by a single thread.
+        std::atomic<uint64_t> mFrameIntervals;
+        std::atomic<double> mMinimumFrameInterval;
+        std::atomic<double> mMeanFrameInterval;
+        std::atomic<double> mMaximumFrameInterval;
+        std::atomic<double> mFrameIntervalJitter;
+
+        //arrival of the last frame, only accessed by the updating thread.
+        std::chrono::steady_clock::time_point mLastArrival;
+        bool mHasLastArrival;
+
+        //interval of the last two frames, only accessed by the updating thread.
+        double mLastInterval;
+};
+}
+#endif
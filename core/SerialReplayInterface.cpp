@@ -0,0 +1,342 @@
+/*
+ * SerialReplayInterface.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SerialReplayInterface.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+using SerialDeviceControl::SerialReplayInterface;
+using SerialDeviceControl::SerialCaptureRecord;
+
+SerialReplayInterface::SerialReplayInterface(const std::string &path, SerialReplayMode mode) :
+    mPath(path),
+    mMode(mode),
+    mReadFD(-1),
+    mWriteFD(-1),
+    mReplayedByteCount(0),
+    mWrittenByteCount(0)
+{
+
+}
+
+SerialReplayInterface::~SerialReplayInterface()
+{
+    Close();
+}
+
+bool SerialReplayInterface::LoadCapture(const std::string &path, std::vector<SerialCaptureRecord> &records, std::vector<uint8_t> &data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if(file == nullptr)
+    {
+        std::cerr << "unable to open capture file " << path << "!" << std::endl;
+        return false;
+    }
+
+    char magic[SERIAL_CAPTURE_MAGIC_SIZE];
+
+    if(fread(magic, 1, SERIAL_CAPTURE_MAGIC_SIZE, file) != SERIAL_CAPTURE_MAGIC_SIZE || memcmp(magic, SERIAL_CAPTURE_MAGIC, SERIAL_CAPTURE_MAGIC_SIZE) != 0)
+    {
+        std::cerr << path << " is not a capture file!" << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    uint8_t header[SERIAL_CAPTURE_RECORD_HEADER_SIZE];
+
+    while(fread(header, 1, SERIAL_CAPTURE_RECORD_HEADER_SIZE, file) == SERIAL_CAPTURE_RECORD_HEADER_SIZE)
+    {
+        SerialCaptureRecord record;
+        record.Timestamp = 0;
+
+        for(size_t i = 0; i < 8; i++)
+        {
+            record.Timestamp |= ((uint64_t)header[i]) << (8 * i);
+        }
+
+        record.Direction = header[8] == CaptureTransmitted ? CaptureTransmitted : CaptureReceived;
+        record.Length = header[9] | (((size_t)header[10]) << 8);
+        record.Offset = data.size();
+
+        data.resize(record.Offset + record.Length);
+
+        if(fread(data.data() + record.Offset, 1, record.Length, file) != record.Length)
+        {
+            //the capture was cut short, e.g. by a power loss.
+            data.resize(record.Offset);
+            break;
+        }
+
+        records.push_back(record);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+bool SerialReplayInterface::Open()
+{
+    if(IsOpen())
+    {
+        return true;
+    }
+
+    if(mRecords.empty())
+    {
+        mData.clear();
+
+        if(!LoadCapture(mPath, mRecords, mData))
+        {
+            return false;
+        }
+    }
+
+    int descriptors[2];
+
+    if(pipe(descriptors) != 0)
+    {
+        return false;
+    }
+
+    fcntl(descriptors[0], F_SETFL, fcntl(descriptors[0], F_GETFL) | O_NONBLOCK);
+    fcntl(descriptors[1], F_SETFL, fcntl(descriptors[1], F_GETFL) | O_NONBLOCK);
+
+    mReadFD = descriptors[0];
+    mWriteFD = descriptors[1];
+
+    mStopEvent.Clear();
+    mCompletedEvent.Clear();
+    mReplayedByteCount.store(0);
+    mWrittenByteCount.store(0);
+
+    mReplayThread = std::thread(&SerialReplayInterface::ReplayThreadFunction, this);
+
+    return true;
+}
+
+bool SerialReplayInterface::Close()
+{
+    if(!IsOpen())
+    {
+        return true;
+    }
+
+    mStopEvent.Signal();
+    mReplayThread.join();
+
+    close(mReadFD);
+    close(mWriteFD);
+
+    mReadFD = -1;
+    mWriteFD = -1;
+
+    return true;
+}
+
+bool SerialReplayInterface::IsOpen()
+{
+    return mReadFD > -1;
+}
+
+int SerialReplayInterface::GetFD()
+{
+    return mReadFD;
+}
+
+size_t SerialReplayInterface::BytesToRead()
+{
+    int available = 0;
+
+    if(!IsOpen() || ioctl(mReadFD, FIONREAD, &available) != 0 || available < 0)
+    {
+        return 0;
+    }
+
+    return (size_t)available;
+}
+
+int16_t SerialReplayInterface::ReadByte()
+{
+    uint8_t value = 0;
+
+    if(Read(&value, 1) != 1)
+    {
+        return -1;
+    }
+
+    return value;
+}
+
+size_t SerialReplayInterface::Read(uint8_t* buffer, size_t length)
+{
+    if(!IsOpen() || buffer == nullptr || length == 0)
+    {
+        return 0;
+    }
+
+    ssize_t result = read(mReadFD, buffer, length);
+
+    return result > 0 ? (size_t)result : 0;
+}
+
+size_t SerialReplayInterface::Write(const uint8_t* buffer, size_t offset, size_t length)
+{
+    (void)offset;
+
+    if(!IsOpen() || buffer == nullptr)
+    {
+        return 0;
+    }
+
+    mWrittenByteCount.fetch_add(length, std::memory_order_relaxed);
+
+    return length;
+}
+
+bool SerialReplayInterface::Flush()
+{
+    return true;
+}
+
+bool SerialReplayInterface::WaitForCompletion(int timeoutMilliseconds)
+{
+    return mCompletedEvent.Wait(timeoutMilliseconds);
+}
+
+uint64_t SerialReplayInterface::GetReplayedByteCount()
+{
+    return mReplayedByteCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SerialReplayInterface::GetWrittenByteCount()
+{
+    return mWrittenByteCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SerialReplayInterface::GetCapturedReceivedByteCount()
+{
+    uint64_t count = 0;
+
+    for(size_t i = 0; i < mRecords.size(); i++)
+    {
+        if(mRecords[i].Direction == CaptureReceived)
+        {
+            count += mRecords[i].Length;
+        }
+    }
+
+    return count;
+}
+
+//The pipe is non blocking, the thread waits for free space or the stop event.
+bool SerialReplayInterface::Provide(const uint8_t* data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t written = write(mWriteFD, data, length);
+
+        if(written > 0)
+        {
+            data += written;
+            length -= written;
+            mReplayedByteCount.fetch_add(written, std::memory_order_relaxed);
+            continue;
+        }
+
+        if(written < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            return false;
+        }
+
+        struct pollfd descriptors[2];
+
+        descriptors[0].fd = mWriteFD;
+        descriptors[0].events = POLLOUT;
+        descriptors[0].revents = 0;
+
+        descriptors[1].fd = mStopEvent.GetFD();
+        descriptors[1].events = POLLIN;
+        descriptors[1].revents = 0;
+
+        if(poll(descriptors, 2, -1) < 0 && errno != EINTR)
+        {
+            return false;
+        }
+
+        if(descriptors[1].revents != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//In real time mode the records are provided relative to the start of the replay, pauses are limited to SERIAL_REPLAY_MAXIMUM_GAP.
+void SerialReplayInterface::ReplayThreadFunction()
+{
+    std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+    uint64_t previousTimestamp = mRecords.empty() ? 0 : mRecords[0].Timestamp;
+
+    for(size_t i = 0; i < mRecords.size(); i++)
+    {
+        const SerialCaptureRecord &record = mRecords[i];
+
+        if(record.Direction != CaptureReceived)
+        {
+            continue;
+        }
+
+        if(mMode == ReplayRealTime)
+        {
+            uint64_t gap = record.Timestamp > previousTimestamp ? record.Timestamp - previousTimestamp : 0;
+            previousTimestamp = record.Timestamp;
+
+            due += std::min(std::chrono::nanoseconds(gap), std::chrono::nanoseconds(std::chrono::milliseconds(SERIAL_REPLAY_MAXIMUM_GAP)));
+
+            long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now()).count();
+
+            if(remaining > 0 && mStopEvent.Wait(remaining))
+            {
+                return;
+            }
+        }
+
+        if(!Provide(mData.data() + record.Offset, record.Length))
+        {
+            return;
+        }
+    }
+
+    mCompletedEvent.Signal();
+}
@@ -0,0 +1,149 @@
+/*
+ * SerialReplayInterface.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SERIALREPLAYINTERFACE_H_INCLUDED_
+#define _SERIALREPLAYINTERFACE_H_INCLUDED_
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+#include "ISerialInterface.hpp"
+#include "EventNotifier.hpp"
+#include "SerialCaptureWriter.hpp"
+
+//in real time mode, longer pauses of the capture (e.g. between two sessions appended to the same file) are shortened to this many milliseconds.
+#define SERIAL_REPLAY_MAXIMUM_GAP (5000)
+
+namespace SerialDeviceControl
+{
+//A record of a capture file, the data is kept in a single buffer of the capture.
+struct SerialCaptureRecord
+{
+    //steady clock time the bytes were read or written, in nanoseconds.
+    uint64_t Timestamp;
+
+    SerialCaptureDirection Direction;
+
+    //position and number of the data bytes in the capture buffer.
+    size_t Offset;
+    size_t Length;
+};
+
+//Pace of the replay.
+enum SerialReplayMode
+{
+    //received bytes are provided with the delays of the capture.
+    ReplayRealTime = 0,
+    //received bytes are provided as fast as the reader consumes them.
+    ReplayAsFastAsPossible = 1
+};
+
+//Serial interface providing the received bytes of a capture file written by the SerialCaptureWriter.
+//The transmitted bytes of the capture are skipped, the bytes written to this interface are only counted.
+//The received data is provided by a pipe, so the descriptor can be polled like a serial device.
+class SerialReplayInterface : public ISerialInterface
+{
+    public:
+        SerialReplayInterface(const std::string &path, SerialReplayMode mode);
+
+        virtual ~SerialReplayInterface();
+
+        //Load the capture file and start providing its received bytes, returns false if the file can not be read.
+        virtual bool Open();
+
+        //Stop the replay, pending data is lost.
+        virtual bool Close();
+
+        virtual bool IsOpen();
+
+        virtual int GetFD();
+
+        virtual size_t BytesToRead();
+
+        virtual int16_t ReadByte();
+
+        virtual size_t Read(uint8_t* buffer, size_t length);
+
+        //The bytes written are counted and dropped.
+        virtual size_t Write(const uint8_t* buffer, size_t offset, size_t length);
+
+        virtual bool Flush();
+
+        //Blocks until all received bytes of the capture were provided or the timeout in milliseconds elapsed, a negative timeout waits forever.
+        //returns true if the replay is complete.
+        bool WaitForCompletion(int timeoutMilliseconds);
+
+        //Returns the number of received bytes provided to the reader.
+        uint64_t GetReplayedByteCount();
+
+        //Returns the number of bytes written to this interface.
+        uint64_t GetWrittenByteCount();
+
+        //Returns the number of received bytes of the capture.
+        uint64_t GetCapturedReceivedByteCount();
+
+        //Read the records of a capture file, the data bytes are appended to the buffer provided.
+        //returns false if the file can not be read or is not a capture file, a truncated last record is dropped.
+        static bool LoadCapture(const std::string &path, std::vector<SerialCaptureRecord> &records, std::vector<uint8_t> &data);
+
+    private:
+        std::string mPath;
+        SerialReplayMode mMode;
+
+        //the loaded capture.
+        std::vector<SerialCaptureRecord> mRecords;
+        std::vector<uint8_t> mData;
+
+        //pipe carrying the received bytes to the reader.
+        int mReadFD;
+        int mWriteFD;
+
+        //feeds the received records into the pipe.
+        std::thread mReplayThread;
+
+        //signaled to stop the replay thread.
+        EventNotifier mStopEvent;
+
+        //signaled by the replay thread when the capture is complete.
+        EventNotifier mCompletedEvent;
+
+        std::atomic<uint64_t> mReplayedByteCount;
+        std::atomic<uint64_t> mWrittenByteCount;
+
+        //write the bytes to the pipe, blocks while the pipe is full. returns false if the replay was stopped.
+        bool Provide(const uint8_t* data, size_t length);
+
+        //Loop of the replay thread.
+        void ReplayThreadFunction();
+
+        //no copies, the descriptors are owned by this instance.
+        SerialReplayInterface(const SerialReplayInterface&);
+        SerialReplayInterface& operator=(const SerialReplayInterface&);
+};
+}
+#endif
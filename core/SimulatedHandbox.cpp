@@ -0,0 +1,664 @@
+/*
+ * SimulatedHandbox.cpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SimulatedHandbox.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+using SerialDeviceControl::SimulatedHandbox;
+
+SimulatedHandbox::SimulatedHandbox() :
+    mThreadRunning(false),
+    mReadFD(-1),
+    mWriteFD(-1),
+    mCommandSynchronizer(*this),
+    mSlewRate(SIMULATED_DEFAULT_SLEW_RATE),
+    mAcceleration(SIMULATED_DEFAULT_ACCELERATION),
+    mMoveStep(SIMULATED_DEFAULT_MOVE_STEP),
+    mTrackingError(SIMULATED_DEFAULT_TRACKING_ERROR),
+    mReportInterval(SIMULATED_DEFAULT_REPORT_INTERVAL),
+    mTracking(false),
+    mParking(false),
+    mParked(true),
+    mReporting(false),
+    mSilent(false),
+    mLatitude(0),
+    mLongitude(0),
+    mLastUpdate(std::chrono::steady_clock::now()),
+    mPowerOnTime(mLastUpdate),
+    mValidCommandCount(0),
+    mInvalidCommandCount(0),
+    mReportCount(0),
+    mDroppedReportCount(0)
+{
+    //the mount powers up in the park/home position, pointing at the celestial pole.
+    mRightAscensionAxis.Position = 0;
+    mRightAscensionAxis.Velocity = 0;
+    mRightAscensionAxis.Target = 0;
+    mRightAscensionAxis.Moving = false;
+
+    mDeclinationAxis.Position = 90;
+    mDeclinationAxis.Velocity = 0;
+    mDeclinationAxis.Target = 90;
+    mDeclinationAxis.Moving = false;
+
+    for(size_t i = 0; i < sizeof(mDateTime); i++)
+    {
+        mDateTime[i] = 0;
+    }
+}
+
+SimulatedHandbox::~SimulatedHandbox()
+{
+    Close();
+}
+
+//Power up the handbox, it stays quiet until it receives the first valid command.
+bool SimulatedHandbox::Open()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if(mThreadRunning)
+    {
+        return true;
+    }
+
+    int descriptors[2];
+
+    if(pipe(descriptors) != 0)
+    {
+        return false;
+    }
+
+    fcntl(descriptors[0], F_SETFL, fcntl(descriptors[0], F_GETFL) | O_NONBLOCK);
+    fcntl(descriptors[1], F_SETFL, fcntl(descriptors[1], F_GETFL) | O_NONBLOCK);
+
+    mReadFD = descriptors[0];
+    mWriteFD = descriptors[1];
+
+    mReporting = false;
+    mSilent = false;
+    mCommandSynchronizer.Reset();
+
+    mLastUpdate = std::chrono::steady_clock::now();
+    mPowerOnTime = mLastUpdate;
+
+    mThreadRunning = true;
+    mReportThread = std::thread(&SimulatedHandbox::ReportThreadFunction, this);
+
+    return true;
+}
+
+bool SimulatedHandbox::Close()
+{
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if(!mThreadRunning)
+        {
+            return true;
+        }
+
+        mThreadRunning = false;
+    }
+
+    mReportCondition.notify_all();
+    mReportThread.join();
+
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    close(mReadFD);
+    close(mWriteFD);
+
+    mReadFD = -1;
+    mWriteFD = -1;
+
+    return true;
+}
+
+bool SimulatedHandbox::IsOpen()
+{
+    return mReadFD > -1;
+}
+
+int SimulatedHandbox::GetFD()
+{
+    return mReadFD;
+}
+
+size_t SimulatedHandbox::BytesToRead()
+{
+    int available = 0;
+
+    if(!IsOpen() || ioctl(mReadFD, FIONREAD, &available) != 0 || available < 0)
+    {
+        return 0;
+    }
+
+    return (size_t)available;
+}
+
+int16_t SimulatedHandbox::ReadByte()
+{
+    uint8_t value = 0;
+
+    if(Read(&value, 1) != 1)
+    {
+        return -1;
+    }
+
+    return value;
+}
+
+size_t SimulatedHandbox::Read(uint8_t* buffer, size_t length)
+{
+    if(!IsOpen() || buffer == nullptr || length == 0)
+    {
+        return 0;
+    }
+
+    ssize_t result = read(mReadFD, buffer, length);
+
+    return result > 0 ? (size_t)result : 0;
+}
+
+//The frames are decoded in the writing thread, the handbox reacts right away.
+size_t SimulatedHandbox::Write(const uint8_t* buffer, size_t offset, size_t length)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    if(!mThreadRunning || buffer == nullptr)
+    {
+        return 0;
+    }
+
+    Advance();
+
+    mCommandSynchronizer.Push(buffer + offset, length);
+
+    return length;
+}
+
+bool SimulatedHandbox::Flush()
+{
+    return true;
+}
+
+void SimulatedHandbox::SetSlewRate(double degreesPerSecond)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    mSlewRate = degreesPerSecond;
+}
+
+void SimulatedHandbox::SetAcceleration(double degreesPerSecondSquared)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    mAcceleration = degreesPerSecondSquared;
+}
+
+void SimulatedHandbox::SetMoveStep(double degrees)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    mMoveStep = degrees;
+}
+
+void SimulatedHandbox::SetTrackingError(double degrees)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    mTrackingError = degrees;
+}
+
+void SimulatedHandbox::SetReportInterval(uint32_t milliseconds)
+{
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mReportInterval = milliseconds > 0 ? milliseconds : 1;
+    }
+
+    mReportCondition.notify_all();
+}
+
+void SimulatedHandbox::SetPointingCoordinates(float rightAscension, float declination)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    Advance();
+
+    mRightAscensionAxis.Position = rightAscension * 15.0;
+    mRightAscensionAxis.Target = mRightAscensionAxis.Position;
+    mRightAscensionAxis.Velocity = 0;
+    mRightAscensionAxis.Moving = false;
+
+    mDeclinationAxis.Position = declination;
+    mDeclinationAxis.Target = declination;
+    mDeclinationAxis.Velocity = 0;
+    mDeclinationAxis.Moving = false;
+}
+
+void SimulatedHandbox::GetPointingCoordinates(float &rightAscension, float &declination)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    Advance();
+
+    rightAscension = ReportedRightAscension();
+    declination = (float)mDeclinationAxis.Position;
+}
+
+bool SimulatedHandbox::IsTracking()
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mTracking;
+}
+
+bool SimulatedHandbox::IsSlewing()
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    Advance();
+    return mRightAscensionAxis.Moving || mDeclinationAxis.Moving;
+}
+
+bool SimulatedHandbox::IsParked()
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    Advance();
+    return mParked;
+}
+
+bool SimulatedHandbox::IsSilent()
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mSilent;
+}
+
+uint64_t SimulatedHandbox::GetValidCommandCount()
+{
+    return mValidCommandCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SimulatedHandbox::GetInvalidCommandCount()
+{
+    return mInvalidCommandCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SimulatedHandbox::GetReportCount()
+{
+    return mReportCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SimulatedHandbox::GetDroppedReportCount()
+{
+    return mDroppedReportCount.load(std::memory_order_relaxed);
+}
+
+void SimulatedHandbox::OnFrameStarted()
+{
+
+}
+
+//Every complete frame is a command, a valid one (re)starts the reports, an invalid one silences the handbox.
+void SimulatedHandbox::OnFrameReceived(const uint8_t* frame)
+{
+    uint8_t command = frame[4];
+
+    if(ExecuteCommand(command, frame))
+    {
+        mValidCommandCount.fetch_add(1, std::memory_order_relaxed);
+
+        mSilent = false;
+        mReporting = (command != SerialCommandID::DISCONNET_COMMAND_ID);
+    }
+    else
+    {
+        mInvalidCommandCount.fetch_add(1, std::memory_order_relaxed);
+
+        mSilent = true;
+    }
+}
+
+bool SimulatedHandbox::ExecuteCommand(uint8_t command, const uint8_t* frame)
+{
+    FloatByteConverter first;
+    FloatByteConverter second;
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        first.bytes[i] = frame[5 + i];
+        second.bytes[i] = frame[9 + i];
+    }
+
+    switch(command)
+    {
+        case SerialCommandID::GOTO_COMMAND_ID:
+        case SerialCommandID::SYNC_COMMAND_ID:
+        {
+            float rightAscension = first.decimal_number;
+            float declination = second.decimal_number;
+
+            if(std::isnan(rightAscension) || std::isnan(declination) ||
+                    rightAscension < 0 || rightAscension > 24 || declination < -90 || declination > 90)
+            {
+                return false;
+            }
+
+            if(command == SerialCommandID::GOTO_COMMAND_ID)
+            {
+                //the controller tracks the target once it is reached.
+                SlewTo(rightAscension * 15.0, declination);
+                mTracking = true;
+                mParking = false;
+            }
+            else
+            {
+                mRightAscensionAxis.Position = rightAscension * 15.0;
+                mRightAscensionAxis.Target = mRightAscensionAxis.Position;
+                mDeclinationAxis.Position = declination;
+                mDeclinationAxis.Target = declination;
+            }
+
+            mParked = false;
+        }
+        return true;
+
+        case SerialCommandID::MOVE_EAST_COMMAND_ID:
+        case SerialCommandID::MOVE_WEST_COMMAND_ID:
+        case SerialCommandID::MOVE_NORTH_COMMAND_ID:
+        case SerialCommandID::MOVE_SOUTH_COMMAND_ID:
+        {
+            //the moves only have an effect while tracking, like the motion buttons of the handbox.
+            if(!mTracking)
+            {
+                return true;
+            }
+
+            SimulatedAxis &axis = (command == SerialCommandID::MOVE_EAST_COMMAND_ID || command == SerialCommandID::MOVE_WEST_COMMAND_ID) ?
+                                  mRightAscensionAxis : mDeclinationAxis;
+            double direction = (command == SerialCommandID::MOVE_EAST_COMMAND_ID || command == SerialCommandID::MOVE_NORTH_COMMAND_ID) ? 1.0 : -1.0;
+
+            axis.Target += direction * mMoveStep;
+            axis.Moving = true;
+
+            if(mDeclinationAxis.Target > 90)
+            {
+                mDeclinationAxis.Target = 90;
+            }
+            else if(mDeclinationAxis.Target < -90)
+            {
+                mDeclinationAxis.Target = -90;
+            }
+        }
+        return true;
+
+        case SerialCommandID::STOP_MOTION_COMMAND_ID:
+            mRightAscensionAxis.Moving = false;
+            mRightAscensionAxis.Velocity = 0;
+            mRightAscensionAxis.Target = mRightAscensionAxis.Position;
+            mDeclinationAxis.Moving = false;
+            mDeclinationAxis.Velocity = 0;
+            mDeclinationAxis.Target = mDeclinationAxis.Position;
+            mTracking = false;
+            mParking = false;
+            return true;
+
+        case SerialCommandID::PARK_COMMAND_ID:
+            if(!mParked)
+            {
+                SlewTo(mRightAscensionAxis.Position, 90);
+                mTracking = false;
+                mParking = true;
+            }
+            return true;
+
+        case SerialCommandID::SET_SITE_LOCATION_COMMAND_ID:
+        {
+            //the set command carries the longitude first.
+            float longitude = first.decimal_number;
+            float latitude = second.decimal_number;
+
+            if(std::isnan(latitude) || std::isnan(longitude) ||
+                    latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180)
+            {
+                return false;
+            }
+
+            mLatitude = latitude;
+            mLongitude = longitude;
+        }
+        return true;
+
+        case SerialCommandID::SET_DATE_TIME_COMMAND_ID:
+            //month and day are 1 based, the hour limit matches the encoder.
+            if(frame[7] < 1 || frame[7] > 12 || frame[8] < 1 || frame[8] > 31 || frame[9] > 24 || frame[10] > 59 || frame[11] > 59)
+            {
+                return false;
+            }
+
+            for(size_t i = 0; i < sizeof(mDateTime); i++)
+            {
+                mDateTime[i] = frame[5 + i];
+            }
+            return true;
+
+        case SerialCommandID::GET_SITE_LOCATION_COMMAND_ID:
+            //the report carries the latitude first, as decoded by the transceiver.
+            SendReport(SerialCommandID::TELESCOPE_SITE_LOCATION_REPORT_COMMAND_ID, mLatitude, mLongitude);
+            return true;
+
+        case SerialCommandID::DISCONNET_COMMAND_ID:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+//Integrate the axis motion since the last update. While not tracking the sky drifts, so the right ascension increases.
+void SimulatedHandbox::Advance()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - mLastUpdate).count();
+    mLastUpdate = now;
+
+    if(seconds <= 0)
+    {
+        return;
+    }
+
+    if(!mTracking && !mParked)
+    {
+        double drift = SIMULATED_SIDEREAL_RATE * seconds;
+
+        mRightAscensionAxis.Position += drift;
+        mRightAscensionAxis.Target += drift;
+    }
+
+    AdvanceAxis(mRightAscensionAxis, seconds, true);
+    AdvanceAxis(mDeclinationAxis, seconds, false);
+
+    if(mParking && !mRightAscensionAxis.Moving && !mDeclinationAxis.Moving)
+    {
+        mParking = false;
+        mParked = true;
+    }
+}
+
+//Move the axis with a trapezoidal velocity profile, it stops exactly at the target.
+void SimulatedHandbox::AdvanceAxis(SimulatedAxis &axis, double seconds, bool wrap)
+{
+    if(!axis.Moving)
+    {
+        return;
+    }
+
+    double distance = axis.Target - axis.Position;
+
+    //the right ascension axis takes the shorter way around.
+    if(wrap)
+    {
+        distance = std::fmod(distance, 360.0);
+
+        if(distance > 180.0)
+        {
+            distance -= 360.0;
+        }
+        else if(distance < -180.0)
+        {
+            distance += 360.0;
+        }
+    }
+
+    //fastest velocity still allowing to stop at the target.
+    double direction = distance < 0 ? -1.0 : 1.0;
+    double desiredVelocity = direction * std::min(mSlewRate, std::sqrt(2.0 * mAcceleration * std::fabs(distance)));
+
+    double velocityChange = mAcceleration * seconds;
+
+    if(axis.Velocity < desiredVelocity)
+    {
+        axis.Velocity = std::min(axis.Velocity + velocityChange, desiredVelocity);
+    }
+    else
+    {
+        axis.Velocity = std::max(axis.Velocity - velocityChange, desiredVelocity);
+    }
+
+    double step = axis.Velocity * seconds;
+
+    if(std::fabs(step) >= std::fabs(distance) || std::fabs(distance) < 1e-9)
+    {
+        axis.Position = axis.Target;
+        axis.Velocity = 0;
+        axis.Moving = false;
+        return;
+    }
+
+    axis.Position += step;
+}
+
+//The right ascension in decimal hours as reported by the controller, including the periodic error of the drive while tracking.
+float SimulatedHandbox::ReportedRightAscension()
+{
+    double trackingError = 0;
+
+    if(mTracking)
+    {
+        double seconds = std::chrono::duration<double>(mLastUpdate - mPowerOnTime).count();
+        trackingError = mTrackingError * std::sin(2.0 * M_PI * seconds / SIMULATED_TRACKING_ERROR_PERIOD);
+    }
+
+    double rightAscensionDegrees = std::fmod(mRightAscensionAxis.Position + trackingError, 360.0);
+
+    if(rightAscensionDegrees < 0)
+    {
+        rightAscensionDegrees += 360.0;
+    }
+
+    return (float)(rightAscensionDegrees / 15.0);
+}
+
+void SimulatedHandbox::SlewTo(double rightAscensionDegrees, double declinationDegrees)
+{
+    mRightAscensionAxis.Target = rightAscensionDegrees;
+    mRightAscensionAxis.Moving = true;
+
+    mDeclinationAxis.Target = declinationDegrees;
+    mDeclinationAxis.Moving = true;
+}
+
+//the reader may fall behind, reports which do not fit into the pipe are dropped like on an overrun serial line.
+void SimulatedHandbox::SendReport(SerialCommandID command, float first, float second)
+{
+    if(mSilent || !mReporting || mWriteFD < 0)
+    {
+        return;
+    }
+
+    MessageFrame frame;
+    frame.fill(0x00);
+
+    for(size_t i = 0; i < MESSAGE_HEADER_SIZE; i++)
+    {
+        frame[i] = SerialCommand::MessageHeader[i];
+    }
+
+    frame[4] = command;
+
+    FloatByteConverter firstBytes;
+    FloatByteConverter secondBytes;
+    firstBytes.decimal_number = first;
+    secondBytes.decimal_number = second;
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        frame[5 + i] = firstBytes.bytes[i];
+        frame[9 + i] = secondBytes.bytes[i];
+    }
+
+    ssize_t written = write(mWriteFD, frame.data(), frame.size());
+
+    if(written == (ssize_t)frame.size())
+    {
+        mReportCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        mDroppedReportCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+//Sends the position reports at the configured cadence.
+void SimulatedHandbox::ReportThreadFunction()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    std::chrono::steady_clock::time_point nextReport = std::chrono::steady_clock::now();
+
+    while(mThreadRunning)
+    {
+        nextReport += std::chrono::milliseconds(mReportInterval);
+
+        //do not burst the missed reports if the thread was held up.
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if(nextReport < now)
+        {
+            nextReport = now;
+        }
+
+        mReportCondition.wait_until(lock, nextReport);
+
+        if(!mThreadRunning)
+        {
+            break;
+        }
+
+        Advance();
+
+        SendReport(SerialCommandID::TELESCOPE_POSITION_REPORT_COMMAND_ID, ReportedRightAscension(), (float)mDeclinationAxis.Position);
+    }
+}
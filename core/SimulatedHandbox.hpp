@@ -0,0 +1,236 @@
+/*
+ * SimulatedHandbox.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SIMULATEDHANDBOX_H_INCLUDED_
+#define _SIMULATEDHANDBOX_H_INCLUDED_
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "config.h"
+
+#include "ISerialInterface.hpp"
+#include "SerialCommand.hpp"
+#include "FrameSynchronizer.hpp"
+
+//apparent rotation of the sky in degrees per second.
+#define SIMULATED_SIDEREAL_RATE (360.0 / 86164.0905)
+
+//default slew rate of both axes in degrees per second.
+#define SIMULATED_DEFAULT_SLEW_RATE (3.0)
+
+//default acceleration of both axes in degrees per second squared.
+#define SIMULATED_DEFAULT_ACCELERATION (1.5)
+
+//default offset of an axis per move command in degrees.
+#define SIMULATED_DEFAULT_MOVE_STEP (0.0005)
+
+//default period of the position reports in milliseconds.
+#define SIMULATED_DEFAULT_REPORT_INTERVAL (500)
+
+//default amplitude of the periodic tracking error in degrees, and its period in seconds.
+#define SIMULATED_DEFAULT_TRACKING_ERROR (1.0 / 3600.0)
+#define SIMULATED_TRACKING_ERROR_PERIOD (480.0)
+
+namespace SerialDeviceControl
+{
+//State of one simulated mount axis, all values in degrees.
+struct SimulatedAxis
+{
+    //current position of the axis.
+    double Position;
+
+    //current angular velocity in degrees per second.
+    double Velocity;
+
+    //position the axis slews to.
+    double Target;
+
+    //true while the axis is slewing to its target.
+    bool Moving;
+};
+
+//In process simulation of the EXOS-2 GoTo handbox, implementing the serial interface.
+//The command frames written are decoded like the controller does, and drive a two axis model with limited slew rate and acceleration.
+//Like the firmware, position reports are sent after the first valid command, and stop after a disconnect or an invalid command,
+//until the next valid command arrives.
+//The received data is provided by a pipe, so the descriptor can be polled like a serial device.
+class SimulatedHandbox : public ISerialInterface
+{
+    public:
+        SimulatedHandbox();
+
+        virtual ~SimulatedHandbox();
+
+        //Power up the simulated handbox and start its report thread.
+        virtual bool Open();
+
+        //Power down the simulated handbox, pending data is lost.
+        virtual bool Close();
+
+        virtual bool IsOpen();
+
+        virtual int GetFD();
+
+        virtual size_t BytesToRead();
+
+        virtual int16_t ReadByte();
+
+        virtual size_t Read(uint8_t* buffer, size_t length);
+
+        //Decode the command frames written, the commands take effect immediately.
+        virtual size_t Write(const uint8_t* buffer, size_t offset, size_t length);
+
+        virtual bool Flush();
+
+        //configuration of the model, may be changed at any time.
+        //slew rate of both axes in degrees per second.
+        void SetSlewRate(double degreesPerSecond);
+
+        //acceleration of both axes in degrees per second squared.
+        void SetAcceleration(double degreesPerSecondSquared);
+
+        //offset of an axis by a single move command in degrees.
+        void SetMoveStep(double degrees);
+
+        //amplitude of the periodic tracking error in degrees, zero for a perfect drive.
+        void SetTrackingError(double degrees);
+
+        //period of the position reports in milliseconds.
+        void SetReportInterval(uint32_t milliseconds);
+
+        //place the mount at the equatorial coordinates provided, decimal hours and degrees.
+        void SetPointingCoordinates(float rightAscension, float declination);
+
+        //returns the current equatorial coordinates of the mount, decimal hours and degrees.
+        void GetPointingCoordinates(float &rightAscension, float &declination);
+
+        //returns true if the simulated mount tracks the sky.
+        bool IsTracking();
+
+        //returns true while an axis of the simulated mount moves to its target.
+        bool IsSlewing();
+
+        //returns true if the simulated mount is in the park position.
+        bool IsParked();
+
+        //returns true if the handbox stopped reporting after an invalid command.
+        bool IsSilent();
+
+        //statistics.
+        uint64_t GetValidCommandCount();
+        uint64_t GetInvalidCommandCount();
+        uint64_t GetReportCount();
+
+        //number of reports lost, since the reader did not keep up.
+        uint64_t GetDroppedReportCount();
+
+    private:
+        //protects the model and the configuration.
+        std::mutex mMutex;
+
+        //signaled to stop the report thread.
+        std::condition_variable mReportCondition;
+
+        //sends the periodic position reports.
+        std::thread mReportThread;
+
+        //running state of the report thread.
+        bool mThreadRunning;
+
+        //pipe carrying the reports to the reader.
+        int mReadFD;
+        int mWriteFD;
+
+        //decodes the written command frames.
+        FrameSynchronizer<SimulatedHandbox> mCommandSynchronizer;
+        friend class FrameSynchronizer<SimulatedHandbox>;
+
+        //right ascension axis, in degrees.
+        SimulatedAxis mRightAscensionAxis;
+
+        //declination axis.
+        SimulatedAxis mDeclinationAxis;
+
+        //model parameters.
+        double mSlewRate;
+        double mAcceleration;
+        double mMoveStep;
+        double mTrackingError;
+        uint32_t mReportInterval;
+
+        //mount state.
+        bool mTracking;
+        bool mParking;
+        bool mParked;
+
+        //report state.
+        bool mReporting;
+        bool mSilent;
+
+        //site location and date time set by the driver.
+        float mLatitude;
+        float mLongitude;
+        uint8_t mDateTime[8];
+
+        //time the model was advanced last.
+        std::chrono::steady_clock::time_point mLastUpdate;
+
+        //time the mount was powered up, used for the tracking error.
+        std::chrono::steady_clock::time_point mPowerOnTime;
+
+        std::atomic<uint64_t> mValidCommandCount;
+        std::atomic<uint64_t> mInvalidCommandCount;
+        std::atomic<uint64_t> mReportCount;
+        std::atomic<uint64_t> mDroppedReportCount;
+
+        //frame synchronizer callbacks, called with mMutex locked.
+        void OnFrameStarted();
+        void OnFrameReceived(const uint8_t* frame);
+
+        //execute a decoded command, returns false if the command is invalid. Requires mMutex to be locked.
+        bool ExecuteCommand(uint8_t command, const uint8_t* frame);
+
+        //advance the model to the current time. Requires mMutex to be locked.
+        void Advance();
+
+        //advance an axis towards its target. Requires mMutex to be locked.
+        void AdvanceAxis(SimulatedAxis &axis, double seconds, bool wrap);
+
+        //returns the right ascension reported in decimal hours. Requires mMutex to be locked.
+        float ReportedRightAscension();
+
+        //slew both axes to the equatorial coordinates provided. Requires mMutex to be locked.
+        void SlewTo(double rightAscensionDegrees, double declinationDegrees);
+
+        //write a report frame to the reader. Requires mMutex to be locked.
+        void SendReport(SerialCommandID command, float first, float second);
+
+        //Loop of the report thread.
+        void ReportThreadFunction();
+};
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+ * SnapshotBuffer.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SNAPSHOTBUFFER_H_INCLUDED_
+#define _SNAPSHOTBUFFER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <type_traits>
+#include "config.h"
+
+#include "CriticalData.hpp"
+
+namespace SerialDeviceControl
+{
+//Publishes immutable snapshots of a trivially copyable type from one writer to any number of readers.
+//The writer fills the slot after the published one and then publishes its count, so it never touches the slot readers are copying.
+//Each slot is a seqlock, a reader only retries when the writer wrapped around to the slot it was copying.
+//Writers have to be serialized by the owner.
+template<typename T, size_t slotCount>
+class SnapshotBuffer
+{
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots are copied word by word.");
+        static_assert(slotCount > 1, "at least two slots are needed.");
+
+    public:
+        //the slots start zero initialized, the owner publishes the initial value.
+        SnapshotBuffer() :
+            mPublishedCount(0)
+        {
+
+        }
+
+        virtual ~SnapshotBuffer()
+        {
+
+        }
+
+        //Writer: store the value in the next slot and make it the published snapshot.
+        void Publish(const T &value)
+        {
+            uint64_t nextCount = mPublishedCount.load(std::memory_order_relaxed) + 1;
+
+            mSlots[nextCount % slotCount].Set(value);
+
+            mPublishedCount.store(nextCount, std::memory_order_release);
+        }
+
+        //Reader, any thread: return the last published snapshot.
+        T Read()
+        {
+            while(true)
+            {
+                uint64_t count = mPublishedCount.load(std::memory_order_acquire);
+
+                T value = mSlots[count % slotCount].Get();
+
+                //the slot is reused once slotCount - 1 newer snapshots are published,
+                //the copy may be of a later snapshot then, which must not be returned ahead of the ones published in between.
+                if(mPublishedCount.load(std::memory_order_acquire) - count < slotCount - 1)
+                {
+                    return value;
+                }
+            }
+        }
+
+    private:
+        //number of snapshots published, the last one is in slot mPublishedCount % slotCount.
+        std::atomic<uint64_t> mPublishedCount;
+
+        //the snapshots, each slot is a seqlock regardless of the size of the type.
+        CriticalData<T, SeqLockStorage> mSlots[slotCount];
+};
+}
+#endif
@@ -0,0 +1,209 @@
+/*
+ * SpscRingBuffer.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _SPSCRINGBUFFER_H_INCLUDED_
+#define _SPSCRINGBUFFER_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include "config.h"
+
+#include "CircularBuffer.hpp"
+
+//assumed cache line size, used to keep the producer and consumer positions apart.
+#define SPSC_CACHE_LINE_SIZE (64)
+
+namespace SerialDeviceControl
+{
+//Wait-free single producer single consumer ring buffer with a power of two capacity.
+//Exactly one thread may call the producer functions (Write, WritableSegments, Commit)
+//and exactly one other thread may call the consumer functions (Peek, Consume, ReadableSegments).
+//Values which do not fit are dropped and counted, so the producer never blocks.
+template<typename T, size_t capacity>
+class SpscRingBuffer
+{
+        static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "the capacity has to be a power of two.");
+
+        static const size_t IndexMask = capacity - 1;
+
+    public:
+        SpscRingBuffer() :
+            mHead(0),
+            mTail(0),
+            mDroppedCount(0),
+            mOverflowCount(0)
+        {
+
+        }
+
+        virtual ~SpscRingBuffer()
+        {
+
+        }
+
+        //maximum number of elements the buffer can hold.
+        static size_t Capacity()
+        {
+            return capacity;
+        }
+
+        //number of elements stored, exact if called by the producer or consumer, a snapshot otherwise.
+        size_t Size()
+        {
+            return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+        }
+
+        bool IsEmpty()
+        {
+            return Size() == 0;
+        }
+
+        //Producer: append up to count values, anything exceeding the free space is dropped and counted.
+        //returns the number of values added.
+        size_t Write(const T* values, size_t count)
+        {
+            BufferSegments<T> segments = WritableSegments();
+
+            size_t accepted = std::min(count, segments.Length());
+            size_t firstLength = std::min(accepted, segments.First.Length);
+
+            std::copy(values, values + firstLength, segments.First.Data);
+            std::copy(values + firstLength, values + accepted, segments.Second.Data);
+
+            Commit(accepted);
+
+            if(accepted < count)
+            {
+                mDroppedCount.fetch_add(count - accepted, std::memory_order_relaxed);
+                mOverflowCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return accepted;
+        }
+
+        //Producer: the free storage to be filled in place and then published using Commit.
+        BufferSegments<T> WritableSegments()
+        {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            size_t head = mHead.load(std::memory_order_acquire);
+
+            return MakeSegments(tail, capacity - (tail - head));
+        }
+
+        //Producer: publish count values written in place to the consumer.
+        void Commit(size_t count)
+        {
+            mTail.store(mTail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        //Consumer: the stored values, for in place processing. Release them using Consume.
+        BufferSegments<T> ReadableSegments()
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t tail = mTail.load(std::memory_order_acquire);
+
+            return MakeSegments(head, tail - head);
+        }
+
+        //Consumer: copy up to count values from the front without removing them, returns the number of values copied.
+        size_t Peek(T* values, size_t count)
+        {
+            BufferSegments<T> segments = ReadableSegments();
+
+            count = std::min(count, segments.Length());
+
+            size_t firstLength = std::min(count, segments.First.Length);
+
+            std::copy(segments.First.Data, segments.First.Data + firstLength, values);
+            std::copy(segments.Second.Data, segments.Second.Data + (count - firstLength), values + firstLength);
+
+            return count;
+        }
+
+        //Consumer: release up to count values from the front, returns the number of values released.
+        size_t Consume(size_t count)
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t tail = mTail.load(std::memory_order_acquire);
+
+            count = std::min(count, tail - head);
+
+            mHead.store(head + count, std::memory_order_release);
+
+            return count;
+        }
+
+        //number of values dropped since the buffer was full.
+        uint64_t GetDroppedCount()
+        {
+            return mDroppedCount.load(std::memory_order_relaxed);
+        }
+
+        //number of writes which did not fit completely, i.e. how often the consumer fell behind.
+        uint64_t GetOverflowCount()
+        {
+            return mOverflowCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        //free running consumer position, only written by the consumer.
+        std::atomic<size_t> mHead;
+
+        //keep the positions on separate cache lines, so producer and consumer do not invalidate each other.
+        //padding instead of alignas, since operator new does not honour over aligned types before C++17.
+        uint8_t mHeadPadding[SPSC_CACHE_LINE_SIZE];
+
+        //free running producer position, only written by the producer.
+        std::atomic<size_t> mTail;
+
+        uint8_t mTailPadding[SPSC_CACHE_LINE_SIZE];
+
+        //overflow statistics, only written by the producer.
+        std::atomic<uint64_t> mDroppedCount;
+
+        std::atomic<uint64_t> mOverflowCount;
+
+        T mBuffer[capacity];
+
+        //split the range of count elements starting at the free running position into its contiguous parts.
+        BufferSegments<T> MakeSegments(size_t position, size_t count)
+        {
+            size_t start = position & IndexMask;
+            size_t firstLength = std::min(count, capacity - start);
+
+            BufferSegments<T> segments;
+
+            segments.First.Data = &mBuffer[start];
+            segments.First.Length = firstLength;
+
+            segments.Second.Data = &mBuffer[0];
+            segments.Second.Length = count - firstLength;
+
+            return segments;
+        }
+};
+}
+
+#endif
@@ -0,0 +1,358 @@
+/*
+ * StateMachine.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _STATEMACHINE_H_INCLUDED_
+#define _STATEMACHINE_H_INCLUDED_
+
+#include <cstdint>
+#include <map>
+#include <unordered_set>
+#include <tuple>
+#include <limits>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include "config.h"
+
+namespace TelescopeMountControl
+{
+//interface template for statemachine transition notification.
+template<typename StateType, typename SignalType>
+class IStateNotification
+{
+    public:
+        //every time a state change occurs this function is called.
+        virtual void OnTransitionChanged(StateType fromState, SignalType signal, StateType toState) = 0;
+
+        //If the error state is triped this callback is called.
+        virtual void OnErrorStateReached(StateType fromState, SignalType signal) = 0;
+};
+
+//state machine with thread safe state transition.
+template<typename StateType, typename SignalType, class NotificationInterfaceImplementation>
+class StateMachine
+{
+        //tuple used for state signal relationship.
+        typedef std::tuple<StateType, SignalType> StateSignal;
+
+    private:
+        //implementation object of the notification inferface
+        NotificationInterfaceImplementation &mStateMachineNotification;
+
+        //transition table of the state changes
+        std::map<StateSignal, StateType> mTransitionTable;
+
+        //set of states which are concidered final.
+        std::unordered_set<StateType> mFinalStates;
+
+        //start state of the state machine.
+        StateType mStartState;
+
+        //any undefined transition causes this state to be active
+        StateType mErrorState;
+
+        //the pointer of the current state.
+        StateType mCurrentState;
+
+        //make this whole thing thread safe.
+        std::mutex mMutex;
+
+    public:
+        StateMachine(NotificationInterfaceImplementation &interfaceImplementation, StateType startState, StateType errorState) :
+            mStateMachineNotification(interfaceImplementation),
+            mStartState(startState),
+            mErrorState(errorState),
+            mCurrentState(mStartState)
+        {
+
+        }
+
+        virtual ~StateMachine()
+        {
+
+        }
+
+        //Reset the machine so it can simply restart.
+        bool Reset()
+        {
+            std::lock_guard<std::mutex> guard(mMutex); //lock this function call to avoid concurrent modification.
+
+            mCurrentState = mStartState;
+
+            return true;
+        }
+
+        //mark a state as final.
+        bool AddFinalState(StateType state)
+        {
+            std::lock_guard<std::mutex> guard(mMutex); //lock this function call to avoid concurrent modification.
+
+            mFinalStates.insert(state);
+
+            return false;
+        }
+
+        //Add a transition from a state to a state tripped by a signal. All types should be in range of the state and signal types.
+        bool AddTransition(StateType fromState, SignalType signal, StateType toState)
+        {
+            std::lock_guard<std::mutex> guard(mMutex); //lock this function call to avoid concurrent modification.
+
+            StateSignal stateSignalTupel = std::make_tuple(fromState, signal);
+
+            if(mTransitionTable.count(stateSignalTupel) == 0) //only deterministic state machines alowed.
+            {
+                mTransitionTable[stateSignalTupel] = toState;
+                return true;
+
+            }
+
+            return false;
+        }
+
+        //submit a signal to the state machine and do a transistion.
+        //the notify interface gets called when a transition or indefined transition occured.
+        bool DoTransition(SignalType signal)
+        {
+            std::lock_guard<std::mutex> guard(mMutex); //lock this function call to avoid concurrent modification.
+
+            StateSignal stateSignalTupel = std::make_tuple(mCurrentState, signal);
+
+            StateType fromState = mCurrentState;
+
+            if(mTransitionTable.count(stateSignalTupel) > 0) //transition defined.
+            {
+                StateType toState = mTransitionTable[stateSignalTupel];
+
+                mCurrentState = toState;
+
+                mStateMachineNotification.OnTransitionChanged(fromState, signal, toState);
+
+                return true;
+            }
+            else //undefined transition.
+            {
+                mCurrentState = mErrorState;
+
+                mStateMachineNotification.OnErrorStateReached(fromState, signal);
+            }
+
+            return false;
+        }
+
+        //returns true if the current state is a final state.
+        bool IsFinalized()
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            if(mFinalStates.count(mCurrentState) > 0)
+            {
+                return true;
+            }
+
+            return false;
+        }
+
+        // Returns true if the state machine is in the error state.
+        bool IsInErrorState()
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            return mCurrentState == mErrorState;
+        }
+
+        //returns the current state of the machine.
+        StateType CurrentState()
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            return mCurrentState;
+        }
+};
+
+//State machine for small enum state spaces, with a flat [state][signal] transition table and a lock free current state.
+//The signals are expected in the range [firstSignal, firstSignal + signalCount), states in the range [0, stateCount).
+//The table is filled by AddTransition/AddFinalState while setting up the machine, before it is shared between threads.
+//Afterwards readers never block, and a transition is one indexed load plus one compare and swap of the current state.
+//If two threads transition concurrently, both transitions are applied one after the other, the notifications are not serialized.
+template<typename StateType, typename SignalType, class NotificationInterfaceImplementation, size_t stateCount, size_t firstSignal, size_t signalCount>
+class DenseStateMachine
+{
+        static_assert(stateCount < 0xff, "the states have to fit into a table entry.");
+        static_assert(stateCount <= 64, "the final states are stored as bit mask.");
+
+        //table entry of an undefined transition.
+        static const uint8_t NoTransition = 0xff;
+
+    private:
+        //implementation object of the notification inferface
+        NotificationInterfaceImplementation &mStateMachineNotification;
+
+        //transition table of the state changes, indexed by the state and the signal offset.
+        uint8_t mTransitionTable[stateCount][signalCount];
+
+        //bit mask of the states which are concidered final.
+        uint64_t mFinalStates;
+
+        //start state of the state machine.
+        StateType mStartState;
+
+        //any undefined transition causes this state to be active
+        StateType mErrorState;
+
+        //the current state.
+        std::atomic<StateType> mCurrentState;
+
+        //returns the state following the state provided, the error state if the transition is undefined.
+        StateType NextState(StateType state, SignalType signal, bool &defined)
+        {
+            size_t signalIndex = (size_t)signal - firstSignal;
+            defined = false;
+
+            if((size_t)state < stateCount && signalIndex < signalCount)
+            {
+                uint8_t next = mTransitionTable[state][signalIndex];
+                defined = next != NoTransition;
+
+                if(defined)
+                {
+                    return (StateType)next;
+                }
+            }
+
+            return mErrorState;
+        }
+
+    public:
+        DenseStateMachine(NotificationInterfaceImplementation &interfaceImplementation, StateType startState, StateType errorState) :
+            mStateMachineNotification(interfaceImplementation),
+            mFinalStates(0),
+            mStartState(startState),
+            mErrorState(errorState),
+            mCurrentState(startState)
+        {
+            for(size_t state = 0; state < stateCount; state++)
+            {
+                for(size_t signal = 0; signal < signalCount; signal++)
+                {
+                    mTransitionTable[state][signal] = NoTransition;
+                }
+            }
+        }
+
+        virtual ~DenseStateMachine()
+        {
+
+        }
+
+        //Reset the machine so it can simply restart.
+        bool Reset()
+        {
+            mCurrentState.store(mStartState, std::memory_order_release);
+
+            return true;
+        }
+
+        //mark a state as final.
+        bool AddFinalState(StateType state)
+        {
+            if((size_t)state >= stateCount)
+            {
+                return false;
+            }
+
+            mFinalStates |= ((uint64_t)1) << state;
+
+            return true;
+        }
+
+        //Add a transition from a state to a state tripped by a signal. All types should be in range of the state and signal types.
+        bool AddTransition(StateType fromState, SignalType signal, StateType toState)
+        {
+            size_t signalIndex = (size_t)signal - firstSignal;
+
+            if((size_t)fromState >= stateCount || (size_t)toState >= stateCount || signalIndex >= signalCount)
+            {
+                return false;
+            }
+
+            if(mTransitionTable[fromState][signalIndex] != NoTransition) //only deterministic state machines alowed.
+            {
+                return false;
+            }
+
+            mTransitionTable[fromState][signalIndex] = (uint8_t)toState;
+
+            return true;
+        }
+
+        //submit a signal to the state machine and do a transistion.
+        //the notify interface gets called when a transition or indefined transition occured.
+        bool DoTransition(SignalType signal)
+        {
+            StateType fromState = mCurrentState.load(std::memory_order_acquire);
+            StateType toState;
+            bool defined;
+
+            //a failed exchange reloads the current state, the transition is looked up again for the new state.
+            //a self transition (e.g. tracking reported while tracking) leaves the state as loaded, so nothing is written.
+            do
+            {
+                toState = NextState(fromState, signal, defined);
+            }
+            while(toState != fromState &&
+                    !mCurrentState.compare_exchange_weak(fromState, toState, std::memory_order_acq_rel, std::memory_order_acquire));
+
+            if(defined)
+            {
+                mStateMachineNotification.OnTransitionChanged(fromState, signal, toState);
+            }
+            else
+            {
+                mStateMachineNotification.OnErrorStateReached(fromState, signal);
+            }
+
+            return defined;
+        }
+
+        //returns true if the current state is a final state.
+        bool IsFinalized()
+        {
+            return (mFinalStates & (((uint64_t)1) << CurrentState())) != 0;
+        }
+
+        // Returns true if the state machine is in the error state.
+        bool IsInErrorState()
+        {
+            return CurrentState() == mErrorState;
+        }
+
+        //returns the current state of the machine.
+        StateType CurrentState()
+        {
+            return mCurrentState.load(std::memory_order_acquire);
+        }
+};
+}
+
+
+#endif
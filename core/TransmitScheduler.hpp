@@ -0,0 +1,656 @@
+/*
+ * TransmitScheduler.hpp
+ *
+ * Copyright 2020 Kevin Krüger <kkevin@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef _TRANSMITSCHEDULER_H_INCLUDED_
+#define _TRANSMITSCHEDULER_H_INCLUDED_
+
+#include <cstdint>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include "config.h"
+
+#include "SerialCommand.hpp"
+#include "CircularBuffer.hpp"
+#include "SerialCaptureWriter.hpp"
+#include "SerialLinkMetrics.hpp"
+
+//9600 baud with 8 data bits, no parity and one stop bit transfers 10 bits per byte.
+#define SERIAL_LINE_BYTES_PER_SECOND (960)
+
+//number of bytes the line model allows to be sent back to back, before the transmission rate is limited.
+#define SERIAL_LINE_BURST_BYTES (4 * MESSAGE_FRAME_SIZE)
+
+//maximum number of frames waiting per priority class, has to be a power of two.
+#define TRANSMIT_QUEUE_SIZE (16)
+
+namespace SerialDeviceControl
+{
+//Delivery state of the frames queued with it, updated by the transmit thread.
+//Lets the source of the frames find out how many of them actually reached the serial interface.
+struct FrameDelivery
+{
+    FrameDelivery() :
+        Written(0),
+        Resolved(0)
+    {
+
+    }
+
+    //frames written to the serial interface completely.
+    std::atomic<uint32_t> Written;
+
+    //frames which left the queue, written, failed to write or dropped by coalescing.
+    std::atomic<uint32_t> Resolved;
+};
+
+//A queued frame, frames of a batch are queued back to back and sent together.
+struct TransmitEntry
+{
+    //the frame to send.
+    MessageFrame Frame;
+
+    //number of frames of the same batch queued right after this one, zero for single frames.
+    uint8_t BatchFollowing;
+
+    //true if the frame is part of a batch, these are not coalesced individually.
+    bool InBatch;
+
+    //milliseconds to wait after sending this frame, before the next frame of the batch.
+    uint16_t InterFrameGap;
+
+    //counts the delivery of the frame, may be empty.
+    std::shared_ptr<FrameDelivery> Delivery;
+};
+
+//Priority classes of the transmitted frames, lower values are sent first.
+enum TransmitPriority
+{
+    //stop/abort and disconnect, never waits behind other frames.
+    StopPriority = 0,
+    //pulse guiding frames.
+    GuidePriority = 1,
+    //manual motion frames while tracking.
+    MotionPriority = 2,
+    //goto, sync and park.
+    GoToPriority = 3,
+    //time and location.
+    ConfigurationPriority = 4,
+    //number of priority classes.
+    TRANSMIT_PRIORITY_COUNT = 5
+};
+
+//Arbitrates the frames of several sources (motion thread, guiding, driver commands) sent to the serial interface.
+//Frames are queued per priority class and sent by a dedicated thread, highest priority first.
+//A token bucket models the capacity of the serial line, so the controller is not flooded.
+//Superseded frames are coalesced:
+//-a stop drops any queued guide, motion and goto frames.
+//-a motion or goto frame replaces queued frames of its class, only the latest one is relevant.
+//-a configuration frame replaces a queued frame of the same command.
+//Batches are queued as a unit, and written to the serial interface by a single write unless an inter frame gap is requested.
+//The bytes written successfully are passed to the capture writer provided, which drops them unless capturing,
+//and counted by the link metrics provided.
+//The InterfaceType has to inherit/implement the ISerialInterface.hpp.
+template<class InterfaceType>
+class TransmitScheduler
+{
+    public:
+        TransmitScheduler(InterfaceType &interfaceImplementation, SerialCaptureWriter &captureWriter, SerialLinkMetrics &linkMetrics) :
+            mInterfaceImplementation(interfaceImplementation),
+            mCaptureWriter(captureWriter),
+            mLinkMetrics(linkMetrics),
+            mThreadRunning(false),
+            mTokens(SERIAL_LINE_BURST_BYTES),
+            mLastRefill(std::chrono::steady_clock::now()),
+            mSentFrameCount(0),
+            mCoalescedFrameCount(0),
+            mRejectedFrameCount(0),
+            mWriteFailureCount(0)
+        {
+
+        }
+
+        virtual ~TransmitScheduler()
+        {
+            Stop();
+        }
+
+        //Start the transmit thread, frames left from a previous session are dropped.
+        bool Start()
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            if(mThreadRunning)
+            {
+                return false;
+            }
+
+            for(size_t priority = 0; priority < TRANSMIT_PRIORITY_COUNT; priority++)
+            {
+                TransmitEntry staleFrame = TransmitEntry();
+
+                while(mQueues[priority].PopFront(staleFrame))
+                {
+                    Resolve(staleFrame.Delivery, false);
+                }
+            }
+
+            mThreadRunning = true;
+            mTokens = SERIAL_LINE_BURST_BYTES;
+            mLastRefill = std::chrono::steady_clock::now();
+
+            mTransmitThread = std::thread(&TransmitScheduler::TransmitThreadFunction, this);
+
+            return true;
+        }
+
+        //Stop the transmit thread, frames queued before are still sent.
+        bool Stop()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+
+                if(!mThreadRunning)
+                {
+                    return false;
+                }
+
+                mThreadRunning = false;
+            }
+
+            mTransmitCondition.notify_all();
+            mTransmitThread.join();
+
+            return true;
+        }
+
+        //Queue a frame to be sent with the priority provided, the delivery provided (if any) counts when the frame leaves the queue.
+        //returns false if the transmit thread is not running or the queue of the priority class is full,
+        //the frame is counted as rejected and the queue is left unchanged then.
+        bool Enqueue(const MessageFrame &frame, TransmitPriority priority,
+                     const std::shared_ptr<FrameDelivery> &delivery = std::shared_ptr<FrameDelivery>())
+        {
+            if(priority >= TRANSMIT_PRIORITY_COUNT)
+            {
+                return false;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+
+                if(!mThreadRunning || mQueues[priority].Free() + SupersededCount(frame, priority) < 1)
+                {
+                    mRejectedFrameCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                Coalesce(frame, priority);
+
+                TransmitEntry entry;
+                entry.Frame = frame;
+                entry.BatchFollowing = 0;
+                entry.InBatch = false;
+                entry.InterFrameGap = 0;
+                entry.Delivery = delivery;
+
+                if(!mQueues[priority].PushBack(entry))
+                {
+                    return false;
+                }
+            }
+
+            mTransmitCondition.notify_all();
+
+            return true;
+        }
+
+        //Queue all frames of the batch to be sent back to back with the priority provided.
+        //returns false if the batch is empty, the transmit thread is not running or the batch does not fit into the queue
+        //of the priority class, nothing is queued or coalesced then and the frames of the batch are counted as rejected.
+        bool EnqueueBatch(const FrameBatch &batch, TransmitPriority priority)
+        {
+            size_t count = batch.Count();
+
+            if(priority >= TRANSMIT_PRIORITY_COUNT || count == 0)
+            {
+                return false;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+
+                //the queued frames the batch supersedes make room for it, but are only dropped if the batch is queued.
+                if(!mThreadRunning || mQueues[priority].Free() + SupersededCount(batch, priority) < count)
+                {
+                    mRejectedFrameCount.fetch_add(count, std::memory_order_relaxed);
+                    return false;
+                }
+
+                //let the batch supersede the queued frames first, it never coalesces itself.
+                for(size_t i = 0; i < count; i++)
+                {
+                    Coalesce(batch.At(i), priority);
+                }
+
+                for(size_t i = 0; i < count; i++)
+                {
+                    TransmitEntry entry;
+                    entry.Frame = batch.At(i);
+                    entry.BatchFollowing = (uint8_t)(count - i - 1);
+                    entry.InBatch = true;
+                    entry.InterFrameGap = batch.GetInterFrameGap();
+                    entry.Delivery.reset();
+
+                    mQueues[priority].PushBack(entry);
+                }
+            }
+
+            mTransmitCondition.notify_all();
+
+            return true;
+        }
+
+        //Drop all frames of a priority class not sent yet.
+        void Discard(TransmitPriority priority)
+        {
+            if(priority >= TRANSMIT_PRIORITY_COUNT)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            DiscardQueue(priority);
+        }
+
+        //number of frames written to the serial interface.
+        uint64_t GetSentFrameCount()
+        {
+            return mSentFrameCount.load(std::memory_order_relaxed);
+        }
+
+        //number of queued frames dropped, since a later frame superseded them.
+        uint64_t GetCoalescedFrameCount()
+        {
+            return mCoalescedFrameCount.load(std::memory_order_relaxed);
+        }
+
+        //number of frames not queued, since the transmit thread was not running or the queue of their priority class was full.
+        uint64_t GetRejectedFrameCount()
+        {
+            return mRejectedFrameCount.load(std::memory_order_relaxed);
+        }
+
+        //number of frames the serial interface failed to write.
+        uint64_t GetWriteFailureCount()
+        {
+            return mWriteFailureCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        //Reference to the serial implementation.
+        InterfaceType &mInterfaceImplementation;
+
+        //records the transmitted bytes while capturing.
+        SerialCaptureWriter &mCaptureWriter;
+
+        //counts the bytes written.
+        SerialLinkMetrics &mLinkMetrics;
+
+        //protects the queues, the token bucket and the running state.
+        std::mutex mMutex;
+
+        //signaled when frames are queued or the thread is stopped.
+        std::condition_variable mTransmitCondition;
+
+        //the thread writing the frames to the serial interface.
+        std::thread mTransmitThread;
+
+        //running state of the transmit thread.
+        bool mThreadRunning;
+
+        //queued frames per priority class.
+        CircularBuffer<TransmitEntry, TRANSMIT_QUEUE_SIZE> mQueues[TRANSMIT_PRIORITY_COUNT];
+
+        //frames sent by a single write, only accessed by the transmit thread.
+        uint8_t mTransmitBuffer[FRAME_BATCH_CAPACITY * MESSAGE_FRAME_SIZE];
+
+        //delivery of each frame of the transmit buffer, only accessed by the transmit thread.
+        std::shared_ptr<FrameDelivery> mTransmitDeliveries[FRAME_BATCH_CAPACITY];
+
+        //bytes which can be sent right now according to the line model.
+        double mTokens;
+
+        //the last time the token bucket was refilled.
+        std::chrono::steady_clock::time_point mLastRefill;
+
+        //statistics.
+        std::atomic<uint64_t> mSentFrameCount;
+        std::atomic<uint64_t> mCoalescedFrameCount;
+        std::atomic<uint64_t> mRejectedFrameCount;
+        std::atomic<uint64_t> mWriteFailureCount;
+
+        //drop queued frames superseded by the frame provided. Requires mMutex to be locked.
+        void Coalesce(const MessageFrame &frame, TransmitPriority priority)
+        {
+            uint8_t command = frame[4];
+
+            switch(priority)
+            {
+                case TransmitPriority::StopPriority:
+                    if(command == SerialCommandID::STOP_MOTION_COMMAND_ID)
+                    {
+                        DiscardQueue(TransmitPriority::GuidePriority);
+                        DiscardQueue(TransmitPriority::MotionPriority);
+                        DiscardQueue(TransmitPriority::GoToPriority);
+                    }
+                    break;
+
+                case TransmitPriority::MotionPriority:
+                case TransmitPriority::GoToPriority:
+                    DiscardQueue(priority);
+                    break;
+
+                case TransmitPriority::ConfigurationPriority:
+                {
+                    CircularBuffer<TransmitEntry, TRANSMIT_QUEUE_SIZE> &queue = mQueues[priority];
+                    size_t queued = queue.Size();
+
+                    //rotate through the queue once, keeping the order of the remaining frames.
+                    for(size_t i = 0; i < queued; i++)
+                    {
+                        TransmitEntry queuedFrame = TransmitEntry();
+                        queue.PopFront(queuedFrame);
+
+                        if(!queuedFrame.InBatch && queuedFrame.Frame[4] == command)
+                        {
+                            mCoalescedFrameCount.fetch_add(1, std::memory_order_relaxed);
+                            Resolve(queuedFrame.Delivery, false);
+                        }
+                        else
+                        {
+                            queue.PushBack(queuedFrame);
+                        }
+                    }
+                }
+                break;
+
+                default:
+                    break;
+            }
+        }
+
+        //returns the number of frames Coalesce would drop from the queue of the priority class, for the frame provided. Requires mMutex to be locked.
+        size_t SupersededCount(const MessageFrame &frame, TransmitPriority priority)
+        {
+            CircularBuffer<TransmitEntry, TRANSMIT_QUEUE_SIZE> &queue = mQueues[priority];
+
+            switch(priority)
+            {
+                case TransmitPriority::MotionPriority:
+                case TransmitPriority::GoToPriority:
+                    return queue.Size();
+
+                case TransmitPriority::ConfigurationPriority:
+                {
+                    size_t superseded = 0;
+
+                    for(size_t i = 0; i < queue.Size(); i++)
+                    {
+                        TransmitEntry queuedFrame = queue.At(i);
+
+                        if(!queuedFrame.InBatch && queuedFrame.Frame[4] == frame[4])
+                        {
+                            superseded++;
+                        }
+                    }
+
+                    return superseded;
+                }
+
+                default:
+                    //a stop only drops frames of the other priority classes.
+                    return 0;
+            }
+        }
+
+        //returns the number of frames the frames of the batch would drop from the queue of the priority class,
+        //each queued frame is counted once, even if several frames of the batch supersede it. Requires mMutex to be locked.
+        size_t SupersededCount(const FrameBatch &batch, TransmitPriority priority)
+        {
+            CircularBuffer<TransmitEntry, TRANSMIT_QUEUE_SIZE> &queue = mQueues[priority];
+
+            if(priority != TransmitPriority::ConfigurationPriority)
+            {
+                return batch.Count() > 0 ? SupersededCount(batch.At(0), priority) : 0;
+            }
+
+            size_t superseded = 0;
+
+            for(size_t i = 0; i < queue.Size(); i++)
+            {
+                TransmitEntry queuedFrame = queue.At(i);
+
+                if(queuedFrame.InBatch)
+                {
+                    continue;
+                }
+
+                for(size_t j = 0; j < batch.Count(); j++)
+                {
+                    if(queuedFrame.Frame[4] == batch.At(j)[4])
+                    {
+                        superseded++;
+                        break;
+                    }
+                }
+            }
+
+            return superseded;
+        }
+
+        //drop all frames of the priority class. Requires mMutex to be locked.
+        void DiscardQueue(TransmitPriority priority)
+        {
+            CircularBuffer<TransmitEntry, TRANSMIT_QUEUE_SIZE> &queue = mQueues[priority];
+
+            mCoalescedFrameCount.fetch_add(queue.Size(), std::memory_order_relaxed);
+
+            TransmitEntry queuedFrame = TransmitEntry();
+
+            while(queue.PopFront(queuedFrame))
+            {
+                Resolve(queuedFrame.Delivery, false);
+            }
+        }
+
+        //count a frame leaving the queue at its delivery, if it has one.
+        static void Resolve(const std::shared_ptr<FrameDelivery> &delivery, bool written)
+        {
+            if(!delivery)
+            {
+                return;
+            }
+
+            if(written)
+            {
+                delivery->Written.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            delivery->Resolved.fetch_add(1, std::memory_order_release);
+        }
+
+        //returns the highest priority class with queued frames, TRANSMIT_PRIORITY_COUNT if all are empty. Requires mMutex to be locked.
+        size_t NextPriority()
+        {
+            size_t priority = 0;
+
+            while(priority < TRANSMIT_PRIORITY_COUNT && mQueues[priority].IsEmpty())
+            {
+                priority++;
+            }
+
+            return priority;
+        }
+
+        //add the bytes the line transferred since the last refill. Requires mMutex to be locked.
+        void RefillTokens()
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed = now - mLastRefill;
+
+            mTokens += elapsed.count() * SERIAL_LINE_BYTES_PER_SECOND;
+
+            if(mTokens > SERIAL_LINE_BURST_BYTES)
+            {
+                mTokens = SERIAL_LINE_BURST_BYTES;
+            }
+
+            mLastRefill = now;
+        }
+
+        //Loop of the transmit thread, sends the queued frames in priority order within the line budget.
+        //When stopped the remaining frames are sent before the thread exits, e.g. the disconnect message.
+        void TransmitThreadFunction()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            while(true)
+            {
+                size_t priority = NextPriority();
+
+                if(priority == TRANSMIT_PRIORITY_COUNT)
+                {
+                    if(!mThreadRunning)
+                    {
+                        break;
+                    }
+
+                    mTransmitCondition.wait(lock);
+                    continue;
+                }
+
+                RefillTokens();
+
+                if(mTokens < MESSAGE_FRAME_SIZE)
+                {
+                    //wait until the line can take another frame, a higher priority frame may arrive meanwhile.
+                    std::chrono::duration<double> budgetDelay((MESSAGE_FRAME_SIZE - mTokens) / SERIAL_LINE_BYTES_PER_SECOND);
+
+                    mTransmitCondition.wait_for(lock, budgetDelay);
+                    continue;
+                }
+
+                //take the frame and the rest of its batch, which is queued right behind it.
+                TransmitEntry entry = TransmitEntry();
+                mQueues[priority].PopFront(entry);
+
+                size_t frameCount = 1;
+                uint16_t interFrameGap = entry.InterFrameGap;
+
+                std::copy(entry.Frame.begin(), entry.Frame.end(), mTransmitBuffer);
+                mTransmitDeliveries[0] = entry.Delivery;
+
+                for(size_t i = 0; i < entry.BatchFollowing; i++)
+                {
+                    TransmitEntry batchEntry = TransmitEntry();
+                    mQueues[priority].PopFront(batchEntry);
+
+                    std::copy(batchEntry.Frame.begin(), batchEntry.Frame.end(), mTransmitBuffer + frameCount * MESSAGE_FRAME_SIZE);
+                    mTransmitDeliveries[frameCount] = batchEntry.Delivery;
+                    frameCount++;
+                }
+
+                //a batch exceeding the burst puts the bucket into debt, delaying the following frames accordingly.
+                mTokens -= frameCount * MESSAGE_FRAME_SIZE;
+
+                lock.unlock();
+
+                TransmitFrames(frameCount, interFrameGap);
+
+                for(size_t i = 0; i < frameCount; i++)
+                {
+                    mTransmitDeliveries[i].reset();
+                }
+
+                lock.lock();
+            }
+        }
+
+        //write the frames of the transmit buffer, by a single write if there is no gap required between them.
+        void TransmitFrames(size_t frameCount, uint16_t interFrameGap)
+        {
+            if(interFrameGap == 0)
+            {
+                WriteFrames(0, frameCount);
+                return;
+            }
+
+            for(size_t i = 0; i < frameCount; i++)
+            {
+                if(i > 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(interFrameGap));
+                }
+
+                WriteFrames(i, 1);
+            }
+        }
+
+        //write frames of the transmit buffer by a single write, and update the statistics and the capture according to the result.
+        //on a partial write the frames written completely count as sent, the others as failed.
+        void WriteFrames(size_t firstFrame, size_t frameCount)
+        {
+            size_t offset = firstFrame * MESSAGE_FRAME_SIZE;
+            size_t length = frameCount * MESSAGE_FRAME_SIZE;
+
+            size_t written = std::min(mInterfaceImplementation.Write(mTransmitBuffer, offset, length), length);
+            size_t framesWritten = written / MESSAGE_FRAME_SIZE;
+
+            mLinkMetrics.AddBytesSent(written);
+
+            if(written > 0)
+            {
+                mCaptureWriter.Record(CaptureTransmitted, mTransmitBuffer + offset, written, std::chrono::steady_clock::now());
+            }
+
+            mSentFrameCount.fetch_add(framesWritten, std::memory_order_relaxed);
+
+            if(framesWritten < frameCount)
+            {
+                mWriteFailureCount.fetch_add(frameCount - framesWritten, std::memory_order_relaxed);
+            }
+
+            for(size_t i = 0; i < frameCount; i++)
+            {
+                Resolve(mTransmitDeliveries[firstFrame + i], i < framesWritten);
+            }
+        }
+};
+}
+#endif